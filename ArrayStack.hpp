@@ -0,0 +1,206 @@
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Constants.hpp"
+#include "StackWaiter.hpp" // CPU_RELAX()
+
+/*
+    Array-based bounded lock-free stack (no nodes, no reclamation)
+
+    For small trivially copyable T (<= 8 bytes): the elements live in one array
+    allocated by the constructor. push/pop never allocate and nothing is ever
+    retired, so there is no EBR / hazard pointer and no pointer chasing.
+
+    Key idea:
+    - top = { value, count, version }  (16 bytes, one CAS)
+      The TOP element travels inside the top word itself; its array slot is
+      written lazily ("finished") by the next operation.
+    - Every operation first finishes the pending write of the current top:
+        slots[count - 1] = { value, version }   only if the slot's version is older
+      then CASes top to the next state with version + 1.
+    - pop needs the element below the top: slots[count - 2], which an earlier
+      operation has already finished.
+
+Per-slot versions:
+    A thread that stalls after reading top can finish a state long gone. The
+    slot CAS only succeeds if the slot holds an OLDER version, so a stale
+    finish can never overwrite a newer element (versions compare modulo 2^32:
+    fine unless one thread stalls for 2^31 operations).
+
+Why 16-byte words:
+    value + version must change together in a slot, and value + count + version
+    in top. Values are stored as raw 8-byte bit patterns (memcpy), so CAS never
+    compares padding bytes.
+    16-byte atomics: clang with -mcx16 inlines LOCK CMPXCHG16B (lock-free).
+    GCC sends every 16-byte std::atomic operation through libatomic: link with
+    -latomic (otherwise: undefined __atomic_compare_exchange_16), and expect
+    is_lock_free() == false there (libatomic may take a lock). There is no
+    static_assert(is_always_lock_free) here, unlike the ABA variant, so the stack
+    still builds with GCC, just not lock-free.
+
+Adjacent slots share cache lines on purpose: memory footprint is the point
+(16 bytes per element instead of one cache line per Node).
+*/
+template <typename T>
+class ArrayStack
+{
+private:
+    static_assert(std::is_trivially_copyable_v<T>, "ArrayStack stores raw bytes");
+    static_assert(sizeof(T) <= sizeof(uint64_t), "ArrayStack: T must fit in 8 bytes");
+
+    struct alignas(16) Top
+    {
+        uint64_t bits;    // top element (valid if count > 0)
+        uint32_t count;   // number of elements
+        uint32_t version; // +1 per successful push/pop
+    };
+
+    struct alignas(16) Slot
+    {
+        uint64_t bits;
+        uint64_t version; // version of the top state that wrote it (zero-extended)
+    };
+
+    static_assert(sizeof(Top) == 16);
+    static_assert(sizeof(Slot) == 16);
+    static_assert(std::is_trivially_copyable_v<Top>);
+    static_assert(std::is_trivially_copyable_v<Slot>);
+
+    const uint32_t cap;
+    std::unique_ptr<std::atomic<Slot>[]> slots;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Top> top{Top{0, 0, 0}};
+
+    static uint64_t to_bits(T const& value)
+    {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(T));
+        return bits;
+    }
+
+    static T from_bits(uint64_t bits)
+    {
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
+
+    // a older than b, modulo 2^32
+    static bool older(uint32_t a, uint32_t b)
+    {
+        return static_cast<int32_t>(a - b) < 0;
+    }
+
+    // ----------------------------
+    // Write t's top element to its slot, unless a newer version is already there
+    // ----------------------------
+    void finish(Top const& t)
+    {
+        if (t.count == 0)
+            return;
+
+        std::atomic<Slot>& slot = slots[t.count - 1];
+        Slot current = slot.load(std::memory_order_acquire);
+        if (older(static_cast<uint32_t>(current.version), t.version))
+        {
+            // Failure: someone else finished it (or a newer state did), both fine
+            slot.compare_exchange_strong(current, Slot{t.bits, t.version},
+                std::memory_order_release,
+                std::memory_order_relaxed);
+        }
+    }
+
+public:
+    ArrayStack(const ArrayStack&) = delete;
+    ArrayStack& operator=(const ArrayStack&) = delete;
+    ArrayStack(ArrayStack&&) = delete;
+    ArrayStack& operator=(ArrayStack&&) = delete;
+
+    // The only allocation, ever
+    explicit ArrayStack(size_t capacity = BOUNDED_STACK_CAPACITY)
+        : cap(static_cast<uint32_t>(capacity))
+    {
+        if (capacity == 0 || capacity > UINT32_MAX)
+            throw std::invalid_argument("ArrayStack: capacity must be in [1, 2^32)");
+
+        slots.reset(new std::atomic<Slot>[capacity]);
+        for (size_t i = 0; i < capacity; ++i)
+            slots[i].store(Slot{0, 0}, std::memory_order_relaxed);
+    }
+
+    // false when full
+    bool push(T const& value)
+    {
+        uint64_t bits = to_bits(value);
+        Top old_top = top.load(std::memory_order_acquire);
+
+        while (true)
+        {
+            finish(old_top);
+
+            if (old_top.count == cap)
+                return false;
+
+            Top new_top{bits, old_top.count + 1, old_top.version + 1};
+            if (top.compare_exchange_weak(old_top, new_top,
+                    std::memory_order_acq_rel,
+                    std::memory_order_acquire))
+            {
+                return true;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    bool pop(T& out)
+    {
+        Top old_top = top.load(std::memory_order_acquire);
+
+        while (true)
+        {
+            if (old_top.count == 0)
+                return false;
+
+            finish(old_top);
+
+            // The element below the top was finished before old_top was installed
+            uint64_t below = (old_top.count > 1)
+                ? slots[old_top.count - 2].load(std::memory_order_acquire).bits
+                : 0;
+
+            Top new_top{below, old_top.count - 1, old_top.version + 1};
+            if (top.compare_exchange_weak(old_top, new_top,
+                    std::memory_order_acq_rel,
+                    std::memory_order_acquire))
+            {
+                out = from_bits(old_top.bits);
+                return true;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    // Fast empty check (may be stale)
+    bool empty() const
+    {
+        return top.load(std::memory_order_acquire).count == 0;
+    }
+
+    size_t size() const
+    {
+        return top.load(std::memory_order_relaxed).count;
+    }
+
+    size_t capacity() const
+    {
+        return cap;
+    }
+};
@@ -0,0 +1,264 @@
+
+#pragma once
+
+// C++20 coroutines only: the whole header is empty in C++17 builds
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "LockFreeTeiberMPMCStack_EBR.hpp"
+
+/*
+    Minimal executor: a queue of coroutine handles drained by run()
+
+    - post() may be called from any thread (producers resume awaiters with it).
+    - run() resumes handles until stop() is called and the queue is empty.
+    - co_await executor.schedule() moves the current coroutine onto the executor.
+*/
+class SimpleExecutor
+{
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::coroutine_handle<>> ready;
+    bool stopping = false;
+
+public:
+    SimpleExecutor() = default;
+    SimpleExecutor(const SimpleExecutor&) = delete;
+    SimpleExecutor& operator=(const SimpleExecutor&) = delete;
+
+    void post(std::coroutine_handle<> h)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            ready.push_back(h);
+        }
+        cv.notify_one();
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            std::coroutine_handle<> h;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this]() { return stopping || !ready.empty(); });
+                if (ready.empty())
+                    return; // stopping and drained
+                h = ready.front();
+                ready.pop_front();
+            }
+            h.resume();
+        }
+    }
+
+    auto schedule()
+    {
+        struct ScheduleAwaiter
+        {
+            SimpleExecutor& executor;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { executor.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return ScheduleAwaiter{*this};
+    }
+};
+
+// Fire-and-forget coroutine: starts eagerly, frees its frame when it finishes
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+/*
+    Stack with an awaitable pop:  std::optional<T> v = co_await stack.pop_async(executor);
+
+    Key idea:
+    - Elements live in an EBR Treiber stack; pop_async() completes inline
+      (no suspension) whenever pop() succeeds.
+    - Otherwise the coroutine parks in a FIFO list of awaiters (mutex, slow path).
+    - push() with a parked awaiter HANDS the value to it and posts it to its
+      executor: the element never goes through head at all.
+
+    push:  waiting == 0 ? stack.push() : hand-off to the oldest awaiter
+
+Lost wake-up (Dekker, same shape as StackWaiter):
+    awaiter : lock ; waiting++ ; fence ; re-check pop() ; enqueue ; unlock
+    producer: stack.push() (seq_cst head CAS) ; if (waiting, seq_cst load) { lock ; move elements to awaiters ; unlock }
+    No producer-side fence: the EBR stack's push CAS is seq_cst (see StackWaiter).
+    The producer that pushed to head while an awaiter was registering moves the
+    element over under the lock, after the awaiter is enqueued.
+
+Shutdown:
+    close() resumes every parked awaiter with std::nullopt; later pop_async()
+    calls return the remaining elements, then std::nullopt.
+*/
+template <typename T>
+class AsyncStack
+{
+private:
+    struct PopAwaiter;
+
+    LockFreeTreiberMPMCStackEBR<T> stack;
+
+    std::mutex mtx;                          // guards 'parked'
+    std::deque<PopAwaiter*> parked;          // oldest first
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> waiting{0}; // parked.size(), read lock-free by producers
+    std::atomic<bool> closed_flag{false};
+    std::atomic<uint64_t> handoff_count{0};
+
+    struct PopAwaiter
+    {
+        AsyncStack& owner;
+        SimpleExecutor& executor;
+        std::optional<T> value;
+        std::coroutine_handle<> handle;
+
+        // try_pop(): T needs neither a default constructor nor a copy
+        bool await_ready()
+        {
+            value = owner.stack.try_pop();
+            return value.has_value();
+        }
+
+        // false: do not suspend (element or shutdown found under the lock)
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            std::lock_guard<std::mutex> lock(owner.mtx);
+
+            owner.waiting.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with push()
+
+            if (std::optional<T> v = owner.stack.try_pop())
+            {
+                owner.waiting.fetch_sub(1, std::memory_order_relaxed);
+                value = std::move(v);
+                return false;
+            }
+            if (owner.closed_flag.load(std::memory_order_acquire))
+            {
+                owner.waiting.fetch_sub(1, std::memory_order_relaxed);
+                return false; // value stays empty
+            }
+
+            handle = h;
+            owner.parked.push_back(this);
+            return true;
+        }
+
+        std::optional<T> await_resume() { return std::move(value); }
+    };
+
+    // Caller holds mtx. Hands 'v' to the oldest parked awaiter.
+    void hand_off_locked(T&& v)
+    {
+        PopAwaiter* awaiter = parked.front();
+        parked.pop_front();
+        waiting.fetch_sub(1, std::memory_order_relaxed);
+
+        awaiter->value.emplace(std::move(v));
+        handoff_count.fetch_add(1, std::memory_order_relaxed);
+        awaiter->executor.post(awaiter->handle); // executor mutex publishes 'value'
+    }
+
+public:
+    AsyncStack(const AsyncStack&) = delete;
+    AsyncStack& operator=(const AsyncStack&) = delete;
+
+    AsyncStack() = default;
+
+    void push(T const& value) { emplace(value); }
+    void push(T&& value) { emplace(std::move(value)); }
+
+    // Builds the value once: in the node (stack.emplace), or straight in the
+    // awaiter's optional when one is parked. Move-only T (std::unique_ptr) works.
+    template <typename... Args>
+    void emplace(Args&&... args)
+    {
+        // Fast path: nobody parked -> plain lock-free push
+        if (waiting.load(std::memory_order_acquire) != 0)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!parked.empty())
+            {
+                hand_off_locked(T(std::forward<Args>(args)...));
+                return;
+            }
+        }
+
+        stack.emplace(std::forward<Args>(args)...);
+
+        // An awaiter may have registered between our check and the push.
+        // seq_cst load after push()'s seq_cst CAS: pairs with await_suspend()'s fence
+        if (waiting.load(std::memory_order_seq_cst) != 0)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            while (!parked.empty())
+            {
+                std::optional<T> v = stack.try_pop();
+                if (!v)
+                    break;
+                hand_off_locked(std::move(*v));
+            }
+        }
+    }
+
+    // co_await stack.pop_async(executor): the element, or std::nullopt once closed
+    // and drained. A suspended coroutine is resumed on 'executor'.
+    PopAwaiter pop_async(SimpleExecutor& executor)
+    {
+        return PopAwaiter{*this, executor, std::nullopt, {}};
+    }
+
+    bool pop(T& out) { return stack.pop(out); }
+    std::optional<T> try_pop() { return stack.try_pop(); }
+
+    bool empty() const { return stack.empty(); }
+
+    // Resume every parked awaiter with std::nullopt. Producers must stop first.
+    void close()
+    {
+        std::deque<PopAwaiter*> to_resume;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed_flag.store(true, std::memory_order_release);
+            to_resume.swap(parked);
+            waiting.store(0, std::memory_order_relaxed);
+        }
+        for (PopAwaiter* awaiter : to_resume)
+            awaiter->executor.post(awaiter->handle);
+    }
+
+    // Elements that went straight from push() to a parked awaiter
+    uint64_t handoffs() const { return handoff_count.load(std::memory_order_relaxed); }
+};
+
+#endif // __cpp_impl_coroutine
@@ -0,0 +1,393 @@
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <type_traits> //For std::is_trivially_copyable_v<CountedPtr>
+#include <utility>
+
+#include "Constants.hpp"
+#include "EBRManager.hpp"
+#include "StackWaiter.hpp" // also defines CPU_RELAX()
+
+// What push() does when the stack is full
+enum class OverflowPolicy
+{
+    Reject,     // push() fails, same as try_push()
+    Block,      // push() parks until a pop makes room
+    DropOldest, // push() always succeeds, the oldest elements are discarded
+};
+
+/*
+    Bounded Treiber stack (EBR) with producer backpressure
+
+    Key idea:
+    - The element count lives in the head word next to the pointer:
+        head = { Node* ptr, uint64_t count }   (16 bytes, one CAS)
+      so "is there room?" and "push" are the same atomic step. The limit is
+      exact, never overshot by racing producers.
+    - No ABA tag is needed: EBR keeps a node's address from being reused while
+      any popper may still hold it, and nodes are never relinked onto head.
+      16-byte CAS: lock-free only where the compiler inlines cmpxchg16b
+      (clang -mcx16). GCC needs -latomic and is not lock-free there, see
+      ArrayStack.
+    - Every head CAS that is followed by a notify is seq_cst: it is the store
+      half of the lost-wake-up Dekker in StackWaiter, which has no fence.
+
+Overflow (template parameter, no runtime branch):
+    Reject     : push() == try_push(), false when full. Nothing is allocated
+                 when the stack is already seen full.
+    Block      : push() retries try_push() through a StackWaiter (spin, then
+                 futex). pop() wakes a parked producer only if one is parked,
+                 so without backpressure a pop pays one extra load (no fence).
+    DropOldest : the oldest elements sit at the BOTTOM of the chain, so making
+                 room costs a walk. A full push copies the newest
+                 capacity - capacity / DROP_DIVISOR elements under the new one
+                 and swaps the whole chain with one CAS; the old chain is retired.
+                 Dropping a quarter at once keeps the copy cost at ~3 nodes per push.
+                 The kept elements are copied, so DropOldest needs a
+                 copy-constructible T (static_assert); Reject and Block also
+                 take move-only payloads (std::unique_ptr).
+
+Move-only payloads:
+    push(T&&) / emplace(args...) build the value inside the node, pop() and
+    try_pop() move it out. A push that fails (Reject: full, Block: closed
+    while full) hands a push(T&&) value back, so nothing is lost.
+
+Shutdown:
+    close() wakes parked consumers (drain, then pop_wait() returns false) and
+    parked Block producers (push() returns false if there is still no room).
+*/
+template <typename T, OverflowPolicy Policy = OverflowPolicy::Reject>
+class BoundedStack
+{
+private:
+    EBRManager ebr;
+
+    // DropOldest discards max(1, capacity / DROP_DIVISOR) elements per overflow
+    static constexpr uint64_t DROP_DIVISOR = 4;
+
+    struct alignas(CACHE_LINE_SIZE) Node
+    {
+        T data;
+        std::atomic<Node*> next;
+        // Builds the value in place: push(const&) copies, push(&&) moves, emplace() forwards
+        template <typename... Args>
+        explicit Node(Args&&... args) : data(std::forward<Args>(args)...), next(nullptr) {}
+    };
+
+    static_assert(Policy != OverflowPolicy::DropOldest || std::is_copy_constructible_v<T>,
+        "DropOldest copies the kept elements into a new chain: T must be copy-constructible");
+
+    struct alignas(16) CountedPtr
+    {
+        Node* ptr;
+        uint64_t count;
+
+        CountedPtr(Node* p = nullptr, uint64_t c = 0)
+            : ptr(p), count(c)
+        {}
+    };
+
+    static_assert(sizeof(CountedPtr) == 16);
+    static_assert(alignof(CountedPtr) == 16);
+    static_assert(std::is_trivially_copyable_v<CountedPtr>);
+
+    const uint64_t cap;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<CountedPtr> head{CountedPtr{}};
+
+    StackWaiter not_empty; // parked pop_wait() consumers
+    StackWaiter not_full;  // parked Block producers
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> dropped_count{0};
+
+public:
+    BoundedStack(const BoundedStack&) = delete;
+    BoundedStack& operator=(const BoundedStack&) = delete;
+    BoundedStack(BoundedStack&&) = delete;
+    BoundedStack& operator=(BoundedStack&&) = delete;
+
+    explicit BoundedStack(size_t capacity = BOUNDED_STACK_CAPACITY)
+        : cap(capacity)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("BoundedStack: capacity must be > 0");
+    }
+
+    // ----------------------------
+    // Push if there is room, false if full (any policy)
+    // ----------------------------
+    bool try_push(T const& value) { return try_emplace(value); }
+    bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+    template <typename... Args>
+    bool try_emplace(Args&&... args)
+    {
+        if (head.load(std::memory_order_relaxed).count >= cap)
+            return false; // full: no allocation
+
+        Node* new_node = new Node(std::forward<Args>(args)...);
+        if (try_link(new_node))
+            return true;
+
+        give_back<Args...>(new_node, args...); // never published
+        return false;
+    }
+
+    // ----------------------------
+    // Push with the overflow policy.
+    // Reject: false when full. Block: false only if closed while full. DropOldest: always true.
+    // ----------------------------
+    bool push(T const& value) { return emplace(value); }
+    bool push(T&& value) { return emplace(std::move(value)); }
+
+    template <typename... Args>
+    bool emplace(Args&&... args)
+    {
+        if constexpr (Policy == OverflowPolicy::Reject)
+        {
+            return try_emplace(std::forward<Args>(args)...);
+        }
+        else if constexpr (Policy == OverflowPolicy::Block)
+        {
+            // One node for all the retries: the value is built once
+            Node* new_node = new Node(std::forward<Args>(args)...);
+            if (not_full.wait([&]() { return try_link(new_node); }))
+                return true;
+
+            give_back<Args...>(new_node, args...);
+            return false;
+        }
+        else
+        {
+            push_dropping(new Node(std::forward<Args>(args)...));
+            return true;
+        }
+    }
+
+    // Moves the value out of the node: move-only T (std::unique_ptr) works
+    bool pop(T& out)
+    {
+        return pop_into([&out](T& data) { out = std::move(data); });
+    }
+
+    // Same, for a T that is not default-constructible
+    std::optional<T> try_pop()
+    {
+        std::optional<T> result;
+        pop_into([&result](T& data) { result.emplace(std::move(data)); });
+        return result;
+    }
+
+    // take(T&) runs on the popped value before the node is retired
+    //Flow: enter_epoch() -> pop() -> retire_node() -> leave_epoch()
+    template <typename Take>
+    bool pop_into(Take&& take)
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        while (true)
+        {
+            CountedPtr old_head = head.load(std::memory_order_acquire);
+            if (!old_head.ptr)
+            {
+                ebr.leave_epoch();
+                return false;
+            }
+
+            Node* next = old_head.ptr->next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, CountedPtr(next, old_head.count - 1),
+                    std::memory_order_seq_cst, // store half of the Dekker with not_full waiters
+                    std::memory_order_relaxed))
+            {
+                take(old_head.ptr->data);
+                ebr.retire_node(old_head.ptr);
+                ebr.leave_epoch(); //NEVER access old_head after leave_epoch()
+
+                if constexpr (Policy == OverflowPolicy::Block)
+                    not_full.notify_one(); // no syscall unless a producer is parked
+                return true;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    // Blocking pop: spin briefly, then park until a push arrives.
+    // Returns false once the stack is closed AND drained.
+    bool pop_wait(T& out)
+    {
+        return not_empty.wait([&]() { return pop(out); });
+    }
+
+    template <typename Clock, typename Duration>
+    PopResult try_pop_until(T& out, std::chrono::time_point<Clock, Duration> const& deadline)
+    {
+        return not_empty.wait_until([&]() { return pop(out); }, deadline);
+    }
+
+    template <typename Rep, typename Period>
+    PopResult try_pop_for(T& out, std::chrono::duration<Rep, Period> const& timeout)
+    {
+        return try_pop_until(out, std::chrono::steady_clock::now() + timeout);
+    }
+
+    // Shutdown: releases parked consumers AND parked Block producers
+    void close()
+    {
+        not_empty.close();
+        not_full.close();
+    }
+
+    bool closed() const
+    {
+        return not_empty.closed();
+    }
+
+    // Exact at the instant of the load (count and pointer change together)
+    size_t size() const
+    {
+        return static_cast<size_t>(head.load(std::memory_order_relaxed).count);
+    }
+
+    size_t capacity() const
+    {
+        return static_cast<size_t>(cap);
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire).ptr == nullptr;
+    }
+
+    // DropOldest: elements discarded so far
+    uint64_t dropped() const
+    {
+        return dropped_count.load(std::memory_order_relaxed);
+    }
+
+    //Single threaded when all other threads have joined and stopped using stack. So, memory_order_relaxed
+    ~BoundedStack()
+    {
+        Node* current = head.exchange(CountedPtr{}, std::memory_order_relaxed).ptr;
+        while (current)
+        {
+            Node* next = current->next.load(std::memory_order_relaxed);
+            delete current;
+            current = next;
+        }
+    }
+
+private:
+    // Links new_node on top if there is room; false if full (new_node stays ours)
+    bool try_link(Node* new_node)
+    {
+        CountedPtr expected = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            if (expected.count >= cap)
+                return false;
+
+            new_node->next.store(expected.ptr, std::memory_order_relaxed);
+            if (head.compare_exchange_weak(expected, CountedPtr(new_node, expected.count + 1),
+                    std::memory_order_seq_cst, // store half of the Dekker with not_empty waiters
+                    std::memory_order_relaxed))
+            {
+                break;
+            }
+            CPU_RELAX();
+        }
+
+        not_empty.notify_one(); // no syscall unless a consumer is parked
+        return true;
+    }
+
+    // Frees a node that was never published. If the push was push(T&&) the
+    // value goes back to the caller, so a failed push does not lose it.
+    template <typename... Args>
+    static void give_back(Node* node, std::remove_reference_t<Args>&... args)
+    {
+        if constexpr (sizeof...(Args) == 1 && (std::is_same_v<Args, T> && ...)) // one T rvalue
+            ((args = std::move(node->data)), ...);
+        delete node;
+    }
+
+    // ----------------------------
+    // DropOldest push: plain push while there is room, otherwise replace the
+    // whole chain by new_node + copies of the newest 'keep' elements (one CAS).
+    // ----------------------------
+    void push_dropping(Node* new_node)
+    {
+        ebr.init_thread();
+        ebr.enter_epoch(); // protects the chain we may walk
+
+        while (true)
+        {
+            CountedPtr expected = head.load(std::memory_order_acquire);
+
+            if (expected.count < cap)
+            {
+                new_node->next.store(expected.ptr, std::memory_order_relaxed);
+                if (head.compare_exchange_weak(expected, CountedPtr(new_node, expected.count + 1),
+                        std::memory_order_seq_cst,
+                        std::memory_order_relaxed))
+                {
+                    ebr.leave_epoch();
+                    break;
+                }
+                CPU_RELAX();
+                continue;
+            }
+
+            // Full. Copies, not relinks: see the ABA note at the top.
+            uint64_t drop = (cap / DROP_DIVISOR > 0) ? cap / DROP_DIVISOR : 1;
+            uint64_t keep = cap - drop;
+
+            Node* last = new_node;
+            Node* node = expected.ptr;
+            for (uint64_t i = 0; i < keep && node; ++i)
+            {
+                Node* copy = new Node(node->data);
+                last->next.store(copy, std::memory_order_relaxed);
+                last = copy;
+                node = node->next.load(std::memory_order_relaxed);
+            }
+            last->next.store(nullptr, std::memory_order_relaxed);
+
+            if (head.compare_exchange_weak(expected, CountedPtr(new_node, keep + 1),
+                    std::memory_order_seq_cst,
+                    std::memory_order_relaxed))
+            {
+                // The old chain is detached and ours; retire it outside our epoch
+                ebr.leave_epoch();
+
+                uint64_t retired = 0;
+                for (Node* old = expected.ptr; old; ++retired)
+                {
+                    Node* next = old->next.load(std::memory_order_relaxed);
+                    ebr.retire_node(old);
+                    old = next;
+                }
+                dropped_count.fetch_add(retired - keep, std::memory_order_relaxed);
+                break;
+            }
+
+            // Lost the race: throw the copies away and look again
+            Node* copy = new_node->next.load(std::memory_order_relaxed);
+            while (copy)
+            {
+                Node* next = copy->next.load(std::memory_order_relaxed);
+                delete copy;
+                copy = next;
+            }
+            CPU_RELAX();
+        }
+
+        not_empty.notify_one();
+    }
+};
@@ -0,0 +1,301 @@
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include "Constants.hpp"
+#include "StackWaiter.hpp" // CPU_RELAX()
+#include "ThreadRegistry.hpp"
+
+/*
+    Size-class buffer pool for variable-length messages (32 B .. 4 KB)
+
+    Key idea:
+    - Power-of-two size classes: 32, 64, 128, 256, 512, 1K, 2K, 4K.
+    - ONE slab, allocated by the constructor, is carved into per-class regions
+      of preallocated buffers. allocate()/deallocate() never call malloc.
+    - Every class has its own index-based Treiber free-list
+      (head = { index, tag } in one 64-bit word, links in a side array; same
+      scheme as ObjectPool). allocate() is ONE pop on the matching class.
+    - Class empty -> try the next larger class (a 100 B message in a 256 B
+      buffer beats a malloc on the feed handler's hot path).
+    - deallocate() finds class and index from the address alone: classes are
+      contiguous ranges of the slab, so no per-buffer header. The class is the
+      first entry of 'class_end' (one read-only cache line) above the address.
+
+Cache alignment:
+    Every buffer starts on its own cache line (stride = max(size, CACHE_LINE_SIZE)),
+    so buffers held by different threads never share a line. The 32 B class
+    pays a full line per buffer for that.
+    Written lines and read-only lines are kept apart:
+      heads[c]   : the class head CAS word, alone on its line (the only shared write)
+      layout[c]  : base / stride / count / next[], set by the constructor, then
+                   only read. It stays in every core's cache in shared state.
+      class_end  : the boundary table deallocate() / buffer_size() scan
+    So freeing a 4 KB buffer reads one clean line to find its class, not the
+    contended head lines of the seven smaller classes.
+
+Statistics (per requested class, per thread):
+    hits   : served by the class itself
+    misses : class was empty (then served by a larger class, or failed)
+    failed : no class at or above it had a buffer, allocate() returned nullptr
+    Each thread (ThreadRegistry index) counts in its own cache lines with a
+    plain load + store (single writer), so allocate() stays ONE locked RMW: the
+    pop. stats() sums all threads, a snapshot that may be slightly behind.
+*/
+class BufferPool
+{
+public:
+    static constexpr size_t MIN_SIZE = 32;
+    static constexpr size_t MAX_SIZE = 4096;
+    static constexpr size_t CLASSES = 8; // 32 << 0 .. 32 << 7
+
+    struct ClassStats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t failed;
+    };
+
+    // Buffer bytes of class c
+    static constexpr size_t class_size(size_t c)
+    {
+        return MIN_SIZE << c;
+    }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    static constexpr int MAX_THREADS = ThreadRegistry::MAX_THREADS;
+
+    // The only word of a class that threads write to (besides next[])
+    struct alignas(CACHE_LINE_SIZE) ClassHead
+    {
+        std::atomic<uint64_t> head{NIL}; // { index (low 32 bits), tag (high 32 bits) }
+    };
+
+    // Set once by the constructor, read-only afterwards
+    struct ClassLayout
+    {
+        char* base = nullptr;   // first buffer of the class in the slab
+        size_t stride = 0;      // distance between buffers
+        uint32_t count = 0;     // buffers in the class
+        std::unique_ptr<std::atomic<uint32_t>[]> next; // free-list links (the array is written, the pointer is not)
+    };
+
+    // One thread's counters; only that thread writes them
+    struct alignas(CACHE_LINE_SIZE) ThreadStats
+    {
+        std::atomic<uint64_t> hits[CLASSES] = {};
+        std::atomic<uint64_t> misses[CLASSES] = {};
+        std::atomic<uint64_t> failed[CLASSES] = {};
+    };
+
+    ClassHead heads[CLASSES];
+
+    alignas(CACHE_LINE_SIZE) ClassLayout layout[CLASSES];
+    alignas(CACHE_LINE_SIZE) char* class_end[CLASSES] = {}; // one past the last buffer of class c
+    char* slab = nullptr;
+    size_t slab_bytes = 0;
+
+    std::unique_ptr<ThreadStats[]> thread_stats;
+
+    // Single writer: no locked RMW on the allocate() path
+    static void bump(std::atomic<uint64_t>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Class of a buffer address, CLASSES if it is not in the slab
+    size_t class_of(char const* ptr) const
+    {
+        if (ptr < slab)
+            return CLASSES;
+        size_t c = 0;
+        while (c < CLASSES && ptr >= class_end[c])
+            ++c;
+        return c;
+    }
+
+    static uint64_t pack(uint32_t index, uint32_t tag)
+    {
+        return (static_cast<uint64_t>(tag) << 32) | index;
+    }
+
+    static uint32_t word_index(uint64_t word) { return static_cast<uint32_t>(word); }
+    static uint32_t word_tag(uint64_t word) { return static_cast<uint32_t>(word >> 32); }
+
+    // Smallest class whose buffers hold 'bytes' (bytes <= MAX_SIZE)
+    static size_t class_for(size_t bytes)
+    {
+        size_t c = 0;
+        while (class_size(c) < bytes)
+            ++c;
+        return c;
+    }
+
+    // ONE CAS. The tag makes a stale next[] read fail the CAS (ABA).
+    uint32_t pop_index(size_t c)
+    {
+        std::atomic<uint64_t>& head = heads[c].head;
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        while (true)
+        {
+            uint32_t index = word_index(old_head);
+            if (index == NIL)
+                return NIL;
+
+            uint32_t below = layout[c].next[index].load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, pack(below, word_tag(old_head) + 1),
+                    std::memory_order_acquire,
+                    std::memory_order_acquire))
+            {
+                return index;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    void push_index(size_t c, uint32_t index)
+    {
+        std::atomic<uint64_t>& head = heads[c].head;
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            layout[c].next[index].store(word_index(old_head), std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, pack(index, word_tag(old_head) + 1),
+                    std::memory_order_release,  // publishes the buffer's last writes
+                    std::memory_order_relaxed))
+            {
+                return;
+            }
+            CPU_RELAX();
+        }
+    }
+
+public:
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    BufferPool(BufferPool&&) = delete;
+    BufferPool& operator=(BufferPool&&) = delete;
+
+    // counts[c] buffers of class c (class_size(c) bytes each), all from ONE slab
+    explicit BufferPool(std::array<uint32_t, CLASSES> const& counts)
+        : thread_stats(new ThreadStats[MAX_THREADS])
+    {
+        for (size_t c = 0; c < CLASSES; ++c)
+        {
+            if (counts[c] >= NIL)
+                throw std::invalid_argument("BufferPool: too many buffers in one class");
+
+            ClassLayout& sc = layout[c];
+            sc.stride = (class_size(c) > CACHE_LINE_SIZE) ? class_size(c) : CACHE_LINE_SIZE;
+            sc.count = counts[c];
+            slab_bytes += sc.stride * sc.count;
+        }
+
+        slab = static_cast<char*>(::operator new(slab_bytes ? slab_bytes : CACHE_LINE_SIZE,
+                                                 std::align_val_t{CACHE_LINE_SIZE}));
+
+        char* cursor = slab;
+        for (size_t c = 0; c < CLASSES; ++c)
+        {
+            ClassLayout& sc = layout[c];
+            sc.base = cursor;
+            cursor += sc.stride * sc.count;
+            class_end[c] = cursor;
+
+            sc.next.reset(new std::atomic<uint32_t>[sc.count ? sc.count : 1]);
+            for (uint32_t i = 0; i < sc.count; ++i)
+                sc.next[i].store(i + 1 < sc.count ? i + 1 : NIL, std::memory_order_relaxed);
+            heads[c].head.store(pack(sc.count ? 0 : NIL, 0), std::memory_order_release);
+        }
+    }
+
+    // Same number of buffers in every class
+    explicit BufferPool(uint32_t buffers_per_class)
+        : BufferPool(uniform(buffers_per_class))
+    {
+    }
+
+    //Single threaded when all other threads have joined
+    ~BufferPool()
+    {
+        ::operator delete(slab, std::align_val_t{CACHE_LINE_SIZE});
+    }
+
+    // A buffer of at least 'bytes' (<= MAX_SIZE), or nullptr. Never mallocs.
+    void* allocate(size_t bytes)
+    {
+        if (bytes > MAX_SIZE)
+            return nullptr;
+
+        ThreadStats& st = thread_stats[ThreadRegistry::thread_index()];
+        size_t wanted = class_for(bytes);
+        for (size_t c = wanted; c < CLASSES; ++c)
+        {
+            uint32_t index = pop_index(c);
+            if (index != NIL)
+            {
+                if (c == wanted)
+                    bump(st.hits[wanted]);
+                return layout[c].base + static_cast<size_t>(index) * layout[c].stride;
+            }
+            if (c == wanted)
+                bump(st.misses[wanted]);
+        }
+
+        bump(st.failed[wanted]);
+        return nullptr;
+    }
+
+    // p must come from this pool's allocate()
+    void deallocate(void* p)
+    {
+        char* ptr = static_cast<char*>(p);
+        size_t c = class_of(ptr);
+        assert(c < CLASSES && "buffer is not from this pool");
+
+        ClassLayout const& sc = layout[c];
+        size_t offset = static_cast<size_t>(ptr - sc.base);
+        assert(offset % sc.stride == 0 && "not a buffer start");
+        push_index(c, static_cast<uint32_t>(offset / sc.stride));
+    }
+
+    // Usable bytes of a buffer from allocate() (may exceed what was asked for)
+    size_t buffer_size(void const* p) const
+    {
+        size_t c = class_of(static_cast<char const*>(p));
+        return (c < CLASSES) ? class_size(c) : 0;
+    }
+
+    // Sum over all threads, may be slightly behind concurrent allocate() calls
+    ClassStats stats(size_t size_class) const
+    {
+        ClassStats total{0, 0, 0};
+        int used = ThreadRegistry::high_watermark();
+        for (int t = 0; t < used; ++t)
+        {
+            ThreadStats const& st = thread_stats[t];
+            total.hits   += st.hits[size_class].load(std::memory_order_relaxed);
+            total.misses += st.misses[size_class].load(std::memory_order_relaxed);
+            total.failed += st.failed[size_class].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    static std::array<uint32_t, CLASSES> uniform(uint32_t n)
+    {
+        std::array<uint32_t, CLASSES> counts;
+        counts.fill(n);
+        return counts;
+    }
+};
@@ -0,0 +1,460 @@
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Constants.hpp"
+#include "EBRManager.hpp"
+#include "NodeChain.hpp"
+#include "StackWaiter.hpp" // CPU_RELAX()
+#include "LockFreeTeiberMPMCStack_EBR.hpp"
+
+/*
+    Stacks specialized by producer / consumer cardinality
+
+    Key idea:
+    - Every other stack here assumes MPMC: any thread may push, any thread
+      may pop, so every pop pays for safe memory reclamation (EBR / HP) and
+      every push can lose a CAS to another push.
+    - When the caller KNOWS how many threads push and pop, most of that can go:
+
+      MPMC : LockFreeTreiberMPMCStackEBR, unchanged (the baseline)
+      MPSC : Treiber push. The one consumer is the only thread that ever
+             dereferences a node, so pop() and pop_all() need no EBR / HP
+             and nodes are deleted on the spot.
+      SPSC : no RMW at all. push is ONE release store of head, the consumer
+             one acquire load per pop; it tracks what it has taken privately.
+      SPMC : push is two release stores (head, then its seq), never contends
+             with anyone; consumers claim the producer's new nodes by sequence
+             number and share them through an EBR Treiber stack.
+
+    Using a specialization with more threads than it was declared for is
+    undefined behaviour, not a slow path.
+
+Single-producer publication (SPSC, SPMC):
+    The producer links each node to ITS previous push (node->next = last) and
+    stores head with release. It never reads head or any node back, so
+    consumers unlinking or freeing nodes can't disturb it. Consumers never
+    write head: push and pop touch no common cache line except for the read
+    of head.
+
+SPSC consumer:
+    Nodes pushed since the last look form a run: head down to (excluding) the
+    previously seen head. The consumer takes the top of the newest run, and
+    keeps older, untaken runs on a private stack of segments. Exact LIFO.
+    The last seen head stays allocated until head moves past it, so a
+    recycled address can never make a new head look already seen (ABA).
+
+SPMC consumers:
+    Nodes carry seq (1, 2, ...), 'count' is the seq of the newest push and
+    'claimed' the highest seq already handed out. While count > claimed, a
+    consumer CASes claimed from s to head->seq, then owns that
+    run: it takes the top node and splices the rest (head->seq - s - 1 nodes,
+    counted, never walking into nodes claimed by others) onto the shared
+    consumer stack. Nodes are retired through EBR like any MPMC pop.
+    Runs spliced concurrently by two consumers may land in either order, so
+    LIFO holds only up to that.
+*/
+enum class Cardinality
+{
+    Single,
+    Multi
+};
+
+template <typename T, Cardinality Producers = Cardinality::Multi, Cardinality Consumers = Cardinality::Multi>
+class CardinalityStack;
+
+template <typename T>
+using MPMCStack = CardinalityStack<T, Cardinality::Multi, Cardinality::Multi>;
+template <typename T>
+using MPSCStack = CardinalityStack<T, Cardinality::Multi, Cardinality::Single>;
+template <typename T>
+using SPMCStack = CardinalityStack<T, Cardinality::Single, Cardinality::Multi>;
+template <typename T>
+using SPSCStack = CardinalityStack<T, Cardinality::Single, Cardinality::Single>;
+
+// ----------------------------
+// MPMC: nothing to specialize
+// ----------------------------
+template <typename T>
+class CardinalityStack<T, Cardinality::Multi, Cardinality::Multi> : public LockFreeTreiberMPMCStackEBR<T>
+{
+};
+
+// ----------------------------
+// MPSC: Treiber push, SMR-free pop
+// ----------------------------
+template <typename T>
+class CardinalityStack<T, Cardinality::Multi, Cardinality::Single>
+{
+private:
+    struct alignas(CACHE_LINE_SIZE) Node
+    {
+        T data;
+        std::atomic<Node*> next;
+        explicit Node(T const& value) : data(value), next(nullptr) {}
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Node*> head{nullptr};
+
+public:
+    CardinalityStack(const CardinalityStack&) = delete;
+    CardinalityStack& operator=(const CardinalityStack&) = delete;
+    CardinalityStack(CardinalityStack&&) = delete;
+    CardinalityStack& operator=(CardinalityStack&&) = delete;
+
+    CardinalityStack() = default;
+
+    // Any thread. Same as the Base stack's push.
+    void push(T const& value)
+    {
+        Node* new_node = new Node(value);
+        Node* expected_head = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            new_node->next.store(expected_head, std::memory_order_relaxed);
+            if (head.compare_exchange_weak(expected_head, new_node,
+                    std::memory_order_release,
+                    std::memory_order_relaxed))
+            {
+                return;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    // Consumer thread only. Strict LIFO, no epoch, no hazard pointer:
+    // - only we delete nodes, so old_head is alive while we read old_head->next
+    // - only we remove nodes, so head can't leave old_head and come back (no ABA)
+    bool pop(T& out)
+    {
+        Node* old_head = head.load(std::memory_order_acquire);
+        while (old_head)
+        {
+            Node* new_head = old_head->next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acquire,
+                    std::memory_order_acquire))
+            {
+                out = old_head->data;
+                delete old_head;
+                return true;
+            }
+            CPU_RELAX();
+        }
+        return false;
+    }
+
+    // Consumer thread only. ONE exchange, then a private walk; the range
+    // deletes the nodes (nobody else can reach them).
+    using Chain = NodeChain<T, Node, DeleteNodes>;
+
+    Chain pop_all(bool fifo = false)
+    {
+        Node* chain = head.exchange(nullptr, std::memory_order_acquire); // pairs with push()'s release CAS
+        Chain all(chain, DeleteNodes{});
+        if (fifo)
+            all.reverse();
+        return all;
+    }
+
+    // Fast empty check (may be stale)
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == nullptr;
+    }
+
+    //Single threaded when all other threads have joined and stopped using stack. So, memory_order_relaxed
+    ~CardinalityStack()
+    {
+        Node* current = head.exchange(nullptr, std::memory_order_relaxed);
+        while (current)
+        {
+            Node* next = current->next.load(std::memory_order_relaxed);
+            delete current;
+            current = next;
+        }
+    }
+};
+
+// ----------------------------
+// SPSC: one release store per push, one acquire load per pop
+// ----------------------------
+template <typename T>
+class CardinalityStack<T, Cardinality::Single, Cardinality::Single>
+{
+private:
+    struct alignas(CACHE_LINE_SIZE) Node
+    {
+        T data;
+        Node* next; // written once by the producer, before head publishes it
+        explicit Node(T const& value) : data(value), next(nullptr) {}
+    };
+
+    // Untaken nodes first .. (excluding) stop, linked through next
+    struct Segment
+    {
+        Node* first;
+        Node* stop;
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Node*> head{nullptr};
+
+    // Producer only
+    alignas(CACHE_LINE_SIZE) Node* last = nullptr;
+
+    // Consumer only
+    alignas(CACHE_LINE_SIZE) Node* seen = nullptr;  // head at the last look
+    bool seen_taken = false;                         // seen was popped, delete it once head moves on
+    std::vector<Segment> segments;                   // older untaken runs, newest at the back
+
+    // ----------------------------
+    // Next node in LIFO order, or nullptr. The caller deletes it unless it is 'seen'.
+    // ----------------------------
+    Node* take()
+    {
+        Node* top = head.load(std::memory_order_acquire); // pairs with push()'s release store
+        if (top != seen)
+        {
+            // New run top .. seen. Everything below top is older: keep it for later.
+            if (top->next != seen)
+                segments.push_back(Segment{top->next, seen});
+            if (seen_taken)
+                delete seen;
+            seen = top;
+            seen_taken = true;
+            return top;
+        }
+
+        if (segments.empty())
+            return nullptr;
+
+        Segment& segment = segments.back();
+        Node* node = segment.first;
+        segment.first = node->next;
+        if (segment.first == segment.stop)
+            segments.pop_back();
+        return node;
+    }
+
+public:
+    CardinalityStack(const CardinalityStack&) = delete;
+    CardinalityStack& operator=(const CardinalityStack&) = delete;
+    CardinalityStack(CardinalityStack&&) = delete;
+    CardinalityStack& operator=(CardinalityStack&&) = delete;
+
+    CardinalityStack() = default;
+
+    // Producer thread only
+    void push(T const& value)
+    {
+        Node* new_node = new Node(value);
+        new_node->next = last;
+        last = new_node;
+        head.store(new_node, std::memory_order_release); // publishes data and next
+    }
+
+    // Consumer thread only
+    bool pop(T& out)
+    {
+        Node* node = take();
+        if (!node)
+            return false;
+
+        out = node->data;
+        if (node != seen)
+            delete node;
+        return true;
+    }
+
+    // Consumer thread only
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == seen && segments.empty();
+    }
+
+    //Single threaded when all other threads have joined and stopped using stack
+    ~CardinalityStack()
+    {
+        while (Node* node = take())
+        {
+            if (node != seen)
+                delete node;
+        }
+        if (seen_taken)
+            delete seen;
+    }
+};
+
+// ----------------------------
+// SPMC: two release stores per push, consumers claim runs by seq
+// ----------------------------
+template <typename T>
+class CardinalityStack<T, Cardinality::Single, Cardinality::Multi>
+{
+private:
+    struct alignas(CACHE_LINE_SIZE) Node
+    {
+        T data;
+        std::atomic<Node*> next;
+        uint64_t seq = 0;
+        explicit Node(T const& value) : data(value), next(nullptr) {}
+    };
+
+    EBRManager ebr;
+
+    // Producer -> consumers, one line: head first, then its seq
+    struct alignas(CACHE_LINE_SIZE) Published
+    {
+        std::atomic<Node*> head{nullptr};
+        std::atomic<uint64_t> count{0};
+    };
+    Published published;
+
+    // Producer only
+    alignas(CACHE_LINE_SIZE) Node* last = nullptr;
+    uint64_t pushed = 0;
+
+    // Consumers only
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> claimed{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<Node*> shared{nullptr}; // claimed but not yet popped
+
+    // ----------------------------
+    // Take the producer's unclaimed run, if any. Caller is inside an epoch.
+    // Returns its top node (ours alone), splices the rest onto 'shared'.
+    //
+    // head can point to a node already claimed and retired, so head is read
+    // only after count says it holds a seq above 'from': that node was not
+    // claimed when we read 'claimed', so it is retired (if ever) inside our epoch.
+    // ----------------------------
+    Node* claim()
+    {
+        uint64_t from = claimed.load(std::memory_order_acquire);
+        while (published.count.load(std::memory_order_acquire) > from)
+        {
+            Node* top = published.head.load(std::memory_order_acquire); // seq >= count just read
+            uint64_t seq = top->seq;
+            if (!claimed.compare_exchange_weak(from, seq,
+                    std::memory_order_acq_rel,
+                    std::memory_order_acquire))
+            {
+                CPU_RELAX();
+                continue; // 'from' reloaded
+            }
+
+            // Ours: top and the seq - from - 1 nodes below it
+            uint64_t rest = seq - from - 1;
+            if (rest > 0)
+            {
+                Node* first = top->next.load(std::memory_order_relaxed);
+                Node* tail = first;
+                for (uint64_t i = 1; i < rest; ++i)
+                    tail = tail->next.load(std::memory_order_relaxed);
+                splice(first, tail);
+            }
+            return top;
+        }
+        return nullptr;
+    }
+
+    void splice(Node* first, Node* tail)
+    {
+        Node* expected = shared.load(std::memory_order_relaxed);
+        while (true)
+        {
+            tail->next.store(expected, std::memory_order_relaxed);
+            if (shared.compare_exchange_weak(expected, first,
+                    std::memory_order_release,
+                    std::memory_order_relaxed))
+            {
+                return;
+            }
+            CPU_RELAX();
+        }
+    }
+
+public:
+    CardinalityStack(const CardinalityStack&) = delete;
+    CardinalityStack& operator=(const CardinalityStack&) = delete;
+    CardinalityStack(CardinalityStack&&) = delete;
+    CardinalityStack& operator=(CardinalityStack&&) = delete;
+
+    CardinalityStack() = default;
+
+    // Producer thread only
+    void push(T const& value)
+    {
+        Node* new_node = new Node(value);
+        new_node->seq = ++pushed;
+        new_node->next.store(last, std::memory_order_relaxed);
+        last = new_node;
+        published.head.store(new_node, std::memory_order_release); // publishes data, seq and next
+        published.count.store(pushed, std::memory_order_release);  // head is at least this new
+    }
+
+    //Flow: enter_epoch() -> claim new run, else Treiber pop of 'shared' -> retire_node() -> leave_epoch()
+    // May return false while another consumer is between its claim and its splice.
+    bool pop(T& out)
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        Node* node = claim();
+        if (!node)
+        {
+            Node* old_head = shared.load(std::memory_order_acquire);
+            while (old_head)
+            {
+                Node* new_head = old_head->next.load(std::memory_order_relaxed);
+                if (shared.compare_exchange_weak(old_head, new_head,
+                        std::memory_order_acq_rel,
+                        std::memory_order_acquire))
+                {
+                    node = old_head;
+                    break;
+                }
+                CPU_RELAX();
+            }
+        }
+
+        if (node)
+        {
+            out = node->data;
+            ebr.retire_node(node); // claim() losers may still read its seq
+        }
+
+        ebr.leave_epoch(); //NEVER access node after leave_epoch()
+        return node != nullptr;
+    }
+
+    // Two counters and a pointer, no node access (may be stale)
+    bool empty() const
+    {
+        return published.count.load(std::memory_order_acquire) <= claimed.load(std::memory_order_acquire) &&
+               shared.load(std::memory_order_acquire) == nullptr;
+    }
+
+    //Single threaded when all other threads have joined and stopped using stack. So, memory_order_relaxed
+    ~CardinalityStack()
+    {
+        Node* top = published.head.load(std::memory_order_relaxed);
+        uint64_t unclaimed = published.count.load(std::memory_order_relaxed) - claimed.load(std::memory_order_relaxed);
+        for (uint64_t i = 0; i < unclaimed; ++i)
+        {
+            Node* next = top->next.load(std::memory_order_relaxed);
+            delete top;
+            top = next;
+        }
+
+        Node* current = shared.exchange(nullptr, std::memory_order_relaxed);
+        while (current)
+        {
+            Node* next = current->next.load(std::memory_order_relaxed);
+            delete current;
+            current = next;
+        }
+    }
+};
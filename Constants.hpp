@@ -14,3 +14,6 @@ constexpr int NUMA_NODE_0 = 0;
 constexpr int NUMA_NODE_1 = 1;
 
 constexpr size_t CACHE_LINE_SIZE = hardware_destructive_interference_size;
+
+// Default capacity of the bounded stacks
+constexpr size_t BOUNDED_STACK_CAPACITY = 1024;
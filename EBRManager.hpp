@@ -6,6 +6,9 @@
 #include <cstdint>
 #include <cstdlib>
 #include <thread>
+#include <stdexcept>
+
+#include "ThreadRegistry.hpp"
 
 /*
     Simplified Fraser-style EBR (Epoch Based Reclamation)
@@ -24,20 +27,24 @@ leave_epoch()
 Reclaimer does:
 -find oldest active thread epoch
 -free everything older than that
+
+Domain:
+-Epochs and thread states are process-wide (static), shared by every EBRManager.
+-The retired list is already thread_local, so one thread may hold nodes of many
+ stacks in it; reclaim() must therefore see the epochs of ALL threads on ALL stacks.
+-Thread ids come from ThreadRegistry so they are unique across stacks.
 */
 
 class EBRManager
 {
 private:
-    //int enough for max thread 128
-    static constexpr int MAX_THREADS = 128;
-    std::atomic<int> next_tid{0};
+    static constexpr int MAX_THREADS = ThreadRegistry::MAX_THREADS;
 
     //uint64_t for epoch 
     //How long we delay reclamation (helps avoid race edge cases)
     static constexpr uint64_t RETIRE_DELAY = 2;
     //Global epoch (advanced during reclamation)
-    std::atomic<uint64_t> global_epoch{0};
+    inline static std::atomic<uint64_t> global_epoch{0};
 
     // ----------------------------
     // Thread state tracking
@@ -50,7 +57,7 @@ private:
         ThreadState() : epoch(0), active(false) {}
     };
 
-    ThreadState threads[MAX_THREADS];
+    inline static ThreadState threads[MAX_THREADS];
 
     // ----------------------------
     // Retired node entry
@@ -67,6 +74,11 @@ private:
     inline static thread_local int tid = -1;
     inline static thread_local std::vector<RetiredNode> retired_list;
 
+    // Batch trigger. Grows while nodes stay pinned by an old active epoch, so that
+    // batch retirement (pop_bulk, steal_half) does not rescan the list on every node.
+    static constexpr size_t RETIRE_THRESHOLD = 256;
+    inline static thread_local size_t reclaim_at = RETIRE_THRESHOLD;
+
 public:
 
     // ----------------------------
@@ -78,13 +90,9 @@ public:
         if (tid != -1) 
             return;
 
-        int id = next_tid.fetch_add(1, std::memory_order_relaxed);
-        if (id >= MAX_THREADS)
-            throw std::runtime_error("Too many threads");
-
-        tid = id;
+        tid = ThreadRegistry::thread_index(); //throws if too many threads
         
-        retired_list.reserve(256);
+        retired_list.reserve(RETIRE_THRESHOLD);
     }
 
 
@@ -130,10 +138,13 @@ public:
         });
 
         // Batch cleanup trigger
-        if (retired_list.size() >= 256)
+        if (retired_list.size() >= reclaim_at)
         {
             advance_epoch();
             reclaim();
+
+            // Still many pinned: wait for twice as many before scanning again
+            reclaim_at = (retired_list.size() * 2 > RETIRE_THRESHOLD) ? retired_list.size() * 2 : RETIRE_THRESHOLD;
         }
     }
 
@@ -154,7 +165,8 @@ private:
         uint64_t oldest_active_thread_epoch = cur_epoch;
 
         // Find oldest epoch among all active threads
-        for (int i = 0; i < MAX_THREADS; ++i)
+        int used = ThreadRegistry::high_watermark();
+        for (int i = 0; i < used; ++i)
         {
             if (threads[i].active.load(std::memory_order_relaxed))
             {
@@ -172,20 +184,16 @@ private:
         //Reclaim only nodes whose retire epoch is older than
         //(oldest active thread's epoch - RETIRE_DELAY).
         //RETIRE_DELAY provides an extra safety buffer before deletion.
-        auto it = retired_list.begin();
-
-        while (it != retired_list.end())
+        //One compacting pass (erase() per freed node would be O(n^2) on big batches)
+        size_t kept = 0;
+        for (size_t i = 0; i < retired_list.size(); ++i)
         {
-            if (it->epoch <= safe_epoch)
-            {
-                it->deleter(it->ptr);
-                it = retired_list.erase(it);
-            }
+            if (retired_list[i].epoch <= safe_epoch)
+                retired_list[i].deleter(retired_list[i].ptr);
             else
-            {
-                ++it;
-            }
+                retired_list[kept++] = retired_list[i];
         }
+        retired_list.resize(kept);
 
     }
 };
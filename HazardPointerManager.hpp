@@ -12,29 +12,45 @@ With hazard pointers:
 
 Thread A says: "I am using old_head"
 Thread B sees hazard → does NOT delete => Safe
+
+Hazard records are process-wide (static): the retired list is thread_local and may hold
+nodes of several stacks, so reclaim() must check the hazards published for ALL stacks.
 */
 #pragma once
 
 #include <atomic>
 #include <thread>
 #include <stdexcept>
+#include <vector>
+
+#include "ThreadRegistry.hpp"
 
 class HazardPointerManager
 {
 private:
-    //int enough for max thread 128
-    static constexpr int MAX_THREADS = 128;
-    std::atomic<int> next_tid{0};
+    static constexpr int MAX_THREADS = ThreadRegistry::MAX_THREADS;
 
     static constexpr size_t RETIRE_THRESHOLD = 256;
-    
 
+public:
+    // Slot 0: the node pop() works on.
+    // Slot 1: hand-over-hand walks (pop_bulk) protect the next node here
+    //         while slot 0 keeps the first one.
+    static constexpr int HAZARDS_PER_THREAD = 2;
+
+private:
     struct HazardRecord
     {
-        std::atomic<void*> pointer{nullptr};
+        std::atomic<void*> pointer[HAZARDS_PER_THREAD];
+
+        HazardRecord()
+        {
+            for (auto& p : pointer)
+                p.store(nullptr, std::memory_order_relaxed);
+        }
     };
 
-    HazardRecord records[MAX_THREADS];
+    inline static HazardRecord records[MAX_THREADS];
 
     struct RetiredNode
     {
@@ -55,11 +71,7 @@ public:
     {
         if (tid != -1) return;
 
-        int id = next_tid.fetch_add(1, std::memory_order_relaxed);
-        if (id >= MAX_THREADS)
-            throw std::runtime_error("Too many threads");
-
-        tid = id;
+        tid = ThreadRegistry::thread_index(); //throws if too many threads
 
         // same as EBR reserve()
         retired_list.reserve(256);
@@ -68,9 +80,9 @@ public:
     // ----------------------------
     // Same as EBR::enter_epoch()
     // ----------------------------
-    void set_hazard(void* ptr)
+    void set_hazard(void* ptr, int slot = 0)
     {
-        records[tid].pointer.store(ptr, std::memory_order_release);
+        records[tid].pointer[slot].store(ptr, std::memory_order_release);
     }
 
     // ----------------------------
@@ -79,7 +91,8 @@ public:
     void clear_hazard()
     {
         if (tid == -1) return;
-        records[tid].pointer.store(nullptr, std::memory_order_release);
+        for (auto& p : records[tid].pointer)
+            p.store(nullptr, std::memory_order_release);
     }
 
     // ----------------------------
@@ -107,6 +120,10 @@ public:
     // ----------------------------
     void reclaim()
     {
+        // Pairs with the fence a reader puts between set_hazard() and its
+        // re-check of head: either it sees our unlink, or we see its hazard.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
         auto it = retired_list.begin();
 
         while (it != retired_list.end())
@@ -128,10 +145,14 @@ public:
     // ----------------------------
     bool is_hazard(void* ptr)
     {
-        for (int i = 0; i < MAX_THREADS; ++i)
+        int used = ThreadRegistry::high_watermark();
+        for (int i = 0; i < used; ++i)
         {
-            if (records[i].pointer.load(std::memory_order_acquire) == ptr)
-                return true;
+            for (auto& p : records[i].pointer)
+            {
+                if (p.load(std::memory_order_acquire) == ptr)
+                    return true;
+            }
         }
         return false;
     }
@@ -0,0 +1,281 @@
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "Constants.hpp"
+#include "EBRManager.hpp"
+#include "LockFreeTeiberMPMCStack_EBR.hpp" // Node
+#include "ThreadRegistry.hpp"
+
+/*
+    Lock-free unordered bag (Sundell-Gidenstam-Papatriantafilou style)
+
+    Key idea:
+    - No shared head. Every thread (ThreadRegistry index) owns a list of chunks;
+      a chunk is an array of ChunkSize slots holding Node pointers.
+    - push: the owner fills the next slot of its newest chunk with ONE release
+      store. No CAS, no epoch, no other thread writes there. A full chunk ->
+      new chunk CASed in front of the owner's list (once per ChunkSize pushes).
+    - pop : scan the OWN list first (newest chunk, highest slot: cache-hot),
+      then steal from other threads' lists, starting at the last victim that
+      had something. A slot is claimed with CAS node -> nullptr.
+    - No order at all between elements: use it where LIFO is not needed.
+
+Why no ABA on slots:
+    A slot goes nullptr -> node -> nullptr exactly once (the owner never refills
+    an emptied slot), so a claiming CAS can never succeed on a recycled value.
+
+Drained chunks (all ChunkSize slots claimed, counted by 'taken'):
+    Any thread may remove them, so a bag drained by stealers while its owner
+    only pushes (or sleeps) does not make every pop rescan dead chunks.
+    Harris-style: mark the low bit of chunk->next (logical delete, next can no
+    longer change), then CAS the predecessor's link past it. A scan that meets
+    a marked chunk helps unlink it. Only the thread whose unlinking CAS wins
+    retires the chunk. The owner inserts at the head only, with a CAS, so it
+    never links anything behind a marked chunk.
+
+Nodes:
+    The EBR stack's own Node (value + next, one cache line); the bag never
+    uses next. A chunk slot holds a Node*.
+
+Reclamation (EBRManager):
+    Unlinked chunks are retired like a stack pop's node. Every list walk runs
+    inside an epoch, so a chunk unlinked under a slow reader stays valid until
+    it leaves. One epoch per list walked, not per pop: a full steal scan can be
+    long, and an epoch held across it would stall reclamation for every thread.
+    Claimed nodes are NOT retired: unlike a stack's head, a slot is never read
+    through. A losing claimer only compares the pointer in its failed CAS and
+    never dereferences it, so the winner deletes the node at once.
+
+Emptiness:
+    pop() returns false after one full scan found nothing; an element pushed
+    during the scan into a slot already passed may be missed (not linearizable
+    emptiness, like RelaxedStack).
+*/
+template <typename T, size_t ChunkSize = 64>
+class LockFreeBag
+{
+private:
+    static_assert(ChunkSize > 0);
+    static constexpr int MAX_THREADS = ThreadRegistry::MAX_THREADS;
+
+    using Node = typename LockFreeTreiberMPMCStackEBR<T>::Node;
+
+    struct Chunk
+    {
+        std::atomic<Node*> slots[ChunkSize] = {};
+        std::atomic<Chunk*> next{nullptr};  // older chunk of the same owner, low bit = deleted
+        std::atomic<size_t> taken{0};       // claimed slots, drained at ChunkSize
+    };
+
+    struct alignas(CACHE_LINE_SIZE) OwnerList
+    {
+        std::atomic<Chunk*> head{nullptr};  // never marked
+
+        // Owner only: the chunk being filled and how far
+        Chunk* current = nullptr;
+        size_t filled = ChunkSize;
+    };
+
+    // empty() walks chunks too, it needs an epoch
+    mutable EBRManager ebr;
+
+    OwnerList lists[MAX_THREADS];
+
+    // Where this thread last stole successfully (shared by all bags: just a hint)
+    inline static thread_local int last_victim = 0;
+
+    static bool is_marked(Chunk* p)
+    {
+        return (reinterpret_cast<uintptr_t>(p) & 1) != 0;
+    }
+
+    static Chunk* marked(Chunk* p)
+    {
+        return reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(p) | 1);
+    }
+
+    static Chunk* unmarked(Chunk* p)
+    {
+        return reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t{1});
+    }
+
+    // ----------------------------
+    // Claim one node from list 'owner', unlinking drained chunks on the way.
+    // Runs in its own epoch: one list at a time keeps epochs short, so a thread
+    // preempted mid-steal pins as little as possible.
+    // The claimed node is ours alone (nobody else can reach it or will ever
+    // dereference it), the caller reads and deletes it.
+    // ----------------------------
+    Node* take_from(int owner)
+    {
+        ebr.enter_epoch();
+    retry:
+        std::atomic<Chunk*>* link = &lists[owner].head;
+        Chunk* chunk = link->load(std::memory_order_acquire);
+        while (chunk)
+        {
+            Chunk* next = chunk->next.load(std::memory_order_acquire);
+            if (is_marked(next))
+            {
+                // Deleted: unlink it. A failed CAS means 'link' changed or was
+                // itself marked, so start over from the head.
+                Chunk* expected = chunk;
+                if (!link->compare_exchange_strong(expected, unmarked(next),
+                        std::memory_order_acq_rel,
+                        std::memory_order_relaxed))
+                {
+                    goto retry;
+                }
+                ebr.retire_node(chunk);
+                chunk = unmarked(next);
+                continue;
+            }
+
+            if (chunk->taken.load(std::memory_order_acquire) == ChunkSize)
+            {
+                // Drained: mark, then the next iteration unlinks it
+                chunk->next.compare_exchange_strong(next, marked(next),
+                    std::memory_order_acq_rel,
+                    std::memory_order_relaxed);
+                continue;
+            }
+
+            for (size_t i = ChunkSize; i-- > 0;)
+            {
+                Node* node = chunk->slots[i].load(std::memory_order_acquire);
+                if (node && chunk->slots[i].compare_exchange_strong(node, nullptr,
+                                std::memory_order_acquire,
+                                std::memory_order_relaxed))
+                {
+                    chunk->taken.fetch_add(1, std::memory_order_release);
+                    ebr.leave_epoch();
+                    return node;
+                }
+            }
+
+            link = &chunk->next;
+            chunk = next;
+        }
+        ebr.leave_epoch();
+        return nullptr;
+    }
+
+public:
+    LockFreeBag(const LockFreeBag&) = delete;
+    LockFreeBag& operator=(const LockFreeBag&) = delete;
+    LockFreeBag(LockFreeBag&&) = delete;
+    LockFreeBag& operator=(LockFreeBag&&) = delete;
+
+    LockFreeBag() = default;
+
+    // Plain store into the own chunk; the epoch is only needed to link a new one
+    void push(T const& value)
+    {
+        ebr.init_thread();
+        OwnerList& list = lists[ThreadRegistry::thread_index()];
+        Node* node = new Node(value);
+
+        // A chunk with free slots cannot be drained, so nobody unlinks it
+        if (list.filled < ChunkSize)
+        {
+            list.current->slots[list.filled++].store(node, std::memory_order_release);
+            return;
+        }
+
+        Chunk* fresh = new Chunk;
+        fresh->slots[0].store(node, std::memory_order_relaxed);
+
+        ebr.enter_epoch(); // the head we link behind may be unlinked by a stealer meanwhile
+        Chunk* head = list.head.load(std::memory_order_acquire);
+        while (true)
+        {
+            fresh->next.store(head, std::memory_order_relaxed);
+            if (list.head.compare_exchange_weak(head, fresh,
+                    std::memory_order_release,  // publishes slot 0
+                    std::memory_order_acquire))
+            {
+                break;
+            }
+            // A stealer unlinked the drained head: link behind the new one
+        }
+        ebr.leave_epoch();
+
+        list.current = fresh;
+        list.filled = 1;
+    }
+
+    //Flow: own list -> other lists from last_victim -> move out -> delete
+    bool pop(T& out)
+    {
+        ebr.init_thread();
+
+        int self = ThreadRegistry::thread_index();
+        Node* node = take_from(self);
+
+        if (!node)
+        {
+            int used = ThreadRegistry::high_watermark();
+            int start = (last_victim < used) ? last_victim : 0;
+            for (int k = 0; k < used && !node; ++k)
+            {
+                int victim = (start + k) % used;
+                if (victim != self && (node = take_from(victim)))
+                    last_victim = victim;
+            }
+        }
+
+        if (!node)
+            return false;
+
+        out = std::move(node->data);
+        delete node; // no reader besides us, see 'Reclamation'
+        return true;
+    }
+
+    // Full scan, may be stale
+    bool empty() const
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        bool any = false;
+        int used = ThreadRegistry::high_watermark();
+        for (int t = 0; t < used && !any; ++t)
+        {
+            for (Chunk* chunk = lists[t].head.load(std::memory_order_acquire); chunk && !any;
+                 chunk = unmarked(chunk->next.load(std::memory_order_acquire)))
+            {
+                if (chunk->taken.load(std::memory_order_relaxed) == ChunkSize)
+                    continue;
+                for (size_t i = 0; i < ChunkSize && !any; ++i)
+                    any = chunk->slots[i].load(std::memory_order_relaxed) != nullptr;
+            }
+        }
+
+        ebr.leave_epoch();
+        return !any;
+    }
+
+    //Single threaded when all other threads have joined and stopped using the bag. So, memory_order_relaxed
+    ~LockFreeBag()
+    {
+        for (OwnerList& list : lists)
+        {
+            Chunk* chunk = list.head.exchange(nullptr, std::memory_order_relaxed);
+            while (chunk)
+            {
+                for (auto& slot : chunk->slots)
+                    delete slot.load(std::memory_order_relaxed);
+
+                Chunk* next = unmarked(chunk->next.load(std::memory_order_relaxed));
+                delete chunk;
+                chunk = next;
+            }
+        }
+    }
+};
@@ -5,6 +5,8 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <optional>
+#include <utility>
 #include <cassert>
 #define _GNU_SOURCE  // Required for CPU affinity functions
 #include <sched.h>   // Contains cpu_set_t definition
@@ -25,6 +27,8 @@
 #endif
 
 #include "Constants.hpp"
+#include "NodeChain.hpp"
+#include "StackWaiter.hpp"
 
 
 //Lock-Free Treiber Stack MPMC 
@@ -35,10 +39,15 @@ private:
     {
         T data;
         std::atomic<Node*> next;
-        explicit Node(T const& value) : data(value), next(nullptr) {}
+        // Builds the value in place: push(const&) copies, push(&&) moves, emplace() forwards
+        template <typename... Args>
+        explicit Node(Args&&... args) : data(std::forward<Args>(args)...), next(nullptr) {}
     };
 
     alignas(CACHE_LINE_SIZE) std::atomic<Node*> head{nullptr};  
+
+    // Parked pop_wait() consumers (own cache line, producers only read it)
+    StackWaiter waiter;
     
 public:
     LockFreeTreiberMPMCStack(const LockFreeTreiberMPMCStack&) = delete;
@@ -49,9 +58,18 @@ public:
 
     LockFreeTreiberMPMCStack() = default;  // Default constructor
     
-    //:::TIPS: All memory_order_relaxed except CAS success = memory_order_release ::::::
-    void push(T const& value) {
-        Node* new_node = new Node(value);// In HFT, use a memory pool
+    void push(T const& value) { emplace(value); }
+    void push(T&& value) { emplace(std::move(value)); }
+
+    // Constructs the value inside the node: no temporary T, no copy
+    //:::TIPS: All memory_order_relaxed except CAS success = memory_order_seq_cst ::::::
+    //CAS success is seq_cst, not just release: it is the store half of the Dekker
+    //with parked consumers (StackWaiter::wake() needs no fence of its own).
+    //On x86 both are the same LOCK CMPXCHG, on ARMv8 CASAL instead of CASL.
+    //Everything said about release below still holds: seq_cst includes it.
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        Node* new_node = new Node(std::forward<Args>(args)...);// In HFT, use a memory pool
         
         //1.We only need a snapshot of head(expected_head) here.
         //If another thread changes head in between load() the CAS,
@@ -112,7 +130,7 @@ public:
            }**********************************************************/
 
             if(head.compare_exchange_weak(expected_head, new_node, 
-                    std::memory_order_release, // (C) =>// (C) publishes the changes made in (A) and (B).
+                    std::memory_order_seq_cst, // (C) =>// (C) publishes the changes made in (A) and (B).
                                                //publishes:
                                                 //* new_node->data
                                                 //* new_node->next
@@ -149,10 +167,27 @@ public:
             // expected_head is updated here on every failure
             // loop retries with the new value
         }
+
+        waiter.notify_one(); // no syscall unless a consumer is parked
     }
   
-    //:::TIPS: acquire->relaxed->acquire->relaxed ::::::
+    // Moves the value out of the node: move-only T (std::unique_ptr) works, a big T is not copied
     bool pop(T& out) {
+        return pop_into([&out](T& data) { out = std::move(data); });
+    }
+
+    // Same, for a T that is not default-constructible
+    std::optional<T> try_pop() {
+        std::optional<T> result;
+        pop_into([&result](T& data) { result.emplace(std::move(data)); });
+        return result;
+    }
+
+    // take(T&) runs on the popped value while the node is still ours (before it
+    // is retired), so the value can be consumed in place without a copy or move
+    //:::TIPS: acquire->relaxed->acquire->relaxed ::::::
+    template <typename Take>
+    bool pop_into(Take&& take) {
 
        while (true) {   
         
@@ -196,7 +231,7 @@ public:
                     std::memory_order_relaxed)) //(F-b) // On failure, CAS updates old_head with the current head value,
                                                         // allowing the loop to retry with the latest state.
              {
-                out = old_head->data;
+                take(old_head->data);
                 //delete old_head; //We cant delete now as other threads might have references to it. 
                 // NOTE:
                 // This implementation intentionally does NOT reclaim nodes.
@@ -219,6 +254,66 @@ public:
         return false;
     }
 
+    // Blocking pop: spin briefly, then park on a futex until a push arrives.
+    // push() wakes only when someone is parked (see StackWaiter).
+    // Returns false once the stack is closed AND drained.
+    bool pop_wait(T& out) {
+        return waiter.wait([&]() { return pop(out); });
+    }
+
+    // Deadline-bounded pop_wait(): PopResult::TimedOut if nothing arrived in time,
+    // PopResult::Closed once closed and drained.
+    template <typename Clock, typename Duration>
+    PopResult try_pop_until(T& out, std::chrono::time_point<Clock, Duration> const& deadline) {
+        return waiter.wait_until([&]() { return pop(out); }, deadline);
+    }
+
+    template <typename Rep, typename Period>
+    PopResult try_pop_for(T& out, std::chrono::duration<Rep, Period> const& timeout) {
+        return try_pop_until(out, std::chrono::steady_clock::now() + timeout);
+    }
+
+    // Shutdown: wakes every blocked consumer, they drain what is left and then
+    // pop_wait() returns false. Producers must stop pushing before close().
+    void close() {
+        waiter.close();
+    }
+
+    bool closed() const {
+        return waiter.closed();
+    }
+
+    // epoll integration: an eventfd that turns readable when elements arrive
+    // (one write per burst, see StackWaiter). Call before the stack is shared.
+    // Loop: fd readable -> ack_event() -> pop() until it fails.
+    int enable_eventfd() {
+        int fd = waiter.enable_eventfd();
+        if (fd >= 0 && !empty())
+            waiter.notify_all(); // already has elements: readable right away
+        return fd;
+    }
+
+    int event_fd() const {
+        return waiter.eventfd_handle();
+    }
+
+    void ack_event() {
+        waiter.ack_event();
+    }
+
+    // Drain everything with ONE exchange on head.
+    // Nodes are kept (not freed) when the range dies, same reason as pop().
+    // fifo = true: oldest push first.
+    using Chain = NodeChain<T, Node, KeepNodes>;
+
+    Chain pop_all(bool fifo = false) {
+        Node* chain = head.exchange(nullptr, std::memory_order_acquire); // pairs with push()'s release CAS
+        Chain all(chain, KeepNodes{});
+        if (fifo)
+            all.reverse();
+        return all;
+    }
+
     // Fast empty check (relaxed, may be stale)
     bool empty() const {
         return head.load(std::memory_order_acquire) == nullptr;
@@ -261,26 +356,41 @@ public:
                 //last = last->next.load(std::memory_order_relaxed); 
                 last = new_node; //Faster, no need to load again like last = last->next.load(..)
             }
-        
-            Node* expected_head = head.load(std::memory_order_relaxed);
-        
-            while (true)
+
+            splice_chain(first, last);
+   } 
+
+private:
+    //StagingBuffer builds private chains of our Node and splices them with splice_chain()
+    template <typename> friend class StagingBuffer;
+
+    // ----------------------------
+    // Splice a private chain first..last onto head with ONE CAS.
+    // Safe against concurrent push/pop: the chain is invisible to other threads
+    // until the CAS succeeds.
+    // Shared by push_bulk_thread_unsafe() and StagingBuffer::flush().
+    // ----------------------------
+    void splice_chain(Node* first, Node* last)
+    {
+        Node* expected_head = head.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            // Attach existing stack after our chain
+            last->next.store(expected_head, std::memory_order_relaxed);
+
+            if (head.compare_exchange_weak(
+                    expected_head,
+                    first,
+                    std::memory_order_seq_cst, // store half of the Dekker, see emplace()
+                    std::memory_order_relaxed))
             {
-                // Attach existing stack after our chain
-                last->next.store(expected_head, std::memory_order_relaxed);
-        
-                if (head.compare_exchange_weak(
-                        expected_head,
-                        first,
-                        std::memory_order_release,
-                        std::memory_order_relaxed))
-                {
-                    break;
-                }
-        
-                CPU_RELAX();
+                break;
             }
-   } 
 
-    
+            CPU_RELAX();
+        }
+
+        waiter.notify_all(); // a chain can feed several parked consumers
+    }
 };
@@ -6,6 +6,8 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <optional>
+#include <utility>
 #include <cassert>
 #define _GNU_SOURCE  // Required for CPU affinity functions
 #include <sched.h>   // Contains cpu_set_t definition
@@ -26,6 +28,8 @@
 #endif
 
 #include "Constants.hpp"
+#include "NodeChain.hpp"
+#include "StackWaiter.hpp"
 
 
 template <typename T>
@@ -35,7 +39,9 @@ private:
     {
         T data;
         std::atomic<Node*> next;
-        explicit Node(T const& value) : data(value), next(nullptr) {}
+        // Builds the value in place: push(const&) copies, push(&&) moves, emplace() forwards
+        template <typename... Args>
+        explicit Node(Args&&... args) : data(std::forward<Args>(args)...), next(nullptr) {}
     };
 
     //This is minimum enhancement for ABA with changes/addition from ABA-1 to ABA-9
@@ -58,12 +64,18 @@ private:
     static_assert(std::is_trivially_copyable_v<TaggedPtrABA>);
     static_assert(std::atomic<TaggedPtrABA>::is_always_lock_free);
 
+    // steal_half() looks at most this many nodes of the victim (and takes half of them)
+    static constexpr size_t STEAL_SCAN_LIMIT = 1024;
+
     //assert() is wrong in class scope
     //assert(_head.is_lock_free());
 
     //ABA-2: Replace Node* with TaggedPtrABA
     //alignas(CACHE_LINE_SIZE) std::atomic<Node*> _head{nullptr};  
     alignas(CACHE_LINE_SIZE) std::atomic<TaggedPtrABA> _head{ TaggedPtrABA{nullptr, 0} };
+
+    // Parked pop_wait() consumers (own cache line, producers only read it)
+    StackWaiter waiter;
     
 public:
     LockFreeTreiberMPMCStackABA(const LockFreeTreiberMPMCStackABA&) = delete;
@@ -74,9 +86,16 @@ public:
 
     LockFreeTreiberMPMCStackABA() = default;
     
-    //:::TIPS: All memory_order_relaxed except CAS success = memory_order_release ::::::
-    void push(T const& value) {
-        Node* new_node = new Node(value);
+    void push(T const& value) { emplace(value); }
+    void push(T&& value) { emplace(std::move(value)); }
+
+    // Constructs the value inside the node: no temporary T, no copy
+    //:::TIPS: All memory_order_relaxed except CAS success = memory_order_seq_cst ::::::
+    //CAS success is seq_cst, not just release: it is the store half of the Dekker
+    //with parked consumers (StackWaiter::wake() needs no fence of its own).
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        Node* new_node = new Node(std::forward<Args>(args)...);
         
         //ABA-3: Replace Node* with TaggedPtrABA
         //Node* expected_head = _head.load(std::memory_order_relaxed); //(A)
@@ -103,7 +122,7 @@ public:
             );
             
             if(_head.compare_exchange_weak(expected_head, desired,
-                                       std::memory_order_release,
+                                       std::memory_order_seq_cst,
                                        std::memory_order_relaxed))
             {
                 break; // Successfully pushed the new node
@@ -123,10 +142,27 @@ public:
             // expected_head is updated here on every failure
             // loop retries with the new value
         }
+
+        waiter.notify_one(); // no syscall unless a consumer is parked
     }
   
-    //:::TIPS: acquire->relaxed->acquire->relaxed ::::::
+    // Moves the value out of the node: move-only T (std::unique_ptr) works, a big T is not copied
     bool pop(T& out) {
+        return pop_into([&out](T& data) { out = std::move(data); });
+    }
+
+    // Same, for a T that is not default-constructible
+    std::optional<T> try_pop() {
+        std::optional<T> result;
+        pop_into([&result](T& data) { result.emplace(std::move(data)); });
+        return result;
+    }
+
+    // take(T&) runs on the popped value while the node is still ours (before it
+    // is retired), so the value can be consumed in place without a copy or move
+    //:::TIPS: acquire->relaxed->acquire->relaxed ::::::
+    template <typename Take>
+    bool pop_into(Take&& take) {
 
         while (true) 
         {
@@ -155,7 +191,7 @@ public:
               
                 //ABA-9: Replace Node* with Node* inside TaggedPtrABA
                 //out = old_head->data;
-                out = old_head.ptr->data;
+                take(old_head.ptr->data);
               
               
                 //delete old_head.ptr; //We cant delete now as other threads might have references to it. 
@@ -167,6 +203,133 @@ public:
         return false;
     }
 
+    // Load balancing: move roughly half of victim's elements onto this stack.
+    // ONE CAS on victim's _head, ONE splice CAS on ours. Returns how many moved.
+    //
+    // Nodes are relinked, not copied: every head change bumps the tag, so a popper
+    // holding a stale {ptr, tag} of either stack fails its CAS even if the same node
+    // shows up on that head again. Nodes are never freed, so the walk needs no protection.
+    // (Only ~LockFreeTreiberMPMCStackABA frees nodes: destroy a thief only once no thread
+    // can still be walking one of its victims.)
+    size_t steal_half(LockFreeTreiberMPMCStackABA& victim) {
+
+        if (&victim == this)
+            return 0;
+
+        while (true)
+        {
+            TaggedPtrABA old_head = victim._head.load(std::memory_order_acquire);
+            if (!old_head.ptr)
+                return 0;
+
+            // Bounded walk, second pointer at half speed: cut is the last node we take
+            Node* cut = old_head.ptr;
+            size_t taken = 1;
+            size_t seen = 1;
+            for (Node* scan = cut->next.load(std::memory_order_relaxed);
+                 scan && seen < STEAL_SCAN_LIMIT;
+                 scan = scan->next.load(std::memory_order_relaxed))
+            {
+                // take (seen + 1) / 2
+                if (++seen % 2 == 1)
+                {
+                    // Links can change under a stale walk (nodes moved on); the CAS below
+                    // then fails, we just must not run off the end
+                    Node* next = cut->next.load(std::memory_order_relaxed);
+                    if (!next)
+                        break;
+                    cut = next;
+                    ++taken;
+                }
+            }
+
+            TaggedPtrABA new_head(
+                cut->next.load(std::memory_order_relaxed),
+                old_head.tag + 1
+            );
+
+            if (victim._head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acquire,
+                    std::memory_order_relaxed))
+            {
+                splice_chain(old_head.ptr, cut); // overwrites cut->next
+                return taken;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    // Blocking pop: spin briefly, then park on a futex until a push arrives.
+    // push() wakes only when someone is parked (see StackWaiter).
+    // Returns false once the stack is closed AND drained.
+    bool pop_wait(T& out) {
+        return waiter.wait([&]() { return pop(out); });
+    }
+
+    // Deadline-bounded pop_wait(): PopResult::TimedOut if nothing arrived in time,
+    // PopResult::Closed once closed and drained.
+    template <typename Clock, typename Duration>
+    PopResult try_pop_until(T& out, std::chrono::time_point<Clock, Duration> const& deadline) {
+        return waiter.wait_until([&]() { return pop(out); }, deadline);
+    }
+
+    template <typename Rep, typename Period>
+    PopResult try_pop_for(T& out, std::chrono::duration<Rep, Period> const& timeout) {
+        return try_pop_until(out, std::chrono::steady_clock::now() + timeout);
+    }
+
+    // Shutdown: wakes every blocked consumer, they drain what is left and then
+    // pop_wait() returns false. Producers must stop pushing before close().
+    void close() {
+        waiter.close();
+    }
+
+    bool closed() const {
+        return waiter.closed();
+    }
+
+    // epoll integration: an eventfd that turns readable when elements arrive
+    // (one write per burst, see StackWaiter). Call before the stack is shared.
+    // Loop: fd readable -> ack_event() -> pop() until it fails.
+    int enable_eventfd() {
+        int fd = waiter.enable_eventfd();
+        if (fd >= 0 && !empty())
+            waiter.notify_all(); // already has elements: readable right away
+        return fd;
+    }
+
+    int event_fd() const {
+        return waiter.eventfd_handle();
+    }
+
+    void ack_event() {
+        waiter.ack_event();
+    }
+
+    // Drain everything with ONE successful CAS on _head.
+    // Not a plain exchange({nullptr, 0}): the tag must keep growing, or a popper
+    // holding an old {ptr, tag} could match a later head again.
+    // Nodes are kept (not freed) when the range dies, same reason as pop().
+    // fifo = true: oldest push first.
+    using Chain = NodeChain<T, Node, KeepNodes>;
+
+    Chain pop_all(bool fifo = false) {
+        TaggedPtrABA old_head = _head.load(std::memory_order_relaxed);
+        while (old_head.ptr &&
+               !_head.compare_exchange_weak(old_head,
+                    TaggedPtrABA(nullptr, old_head.tag + 1),
+                    std::memory_order_acquire,
+                    std::memory_order_relaxed))
+        {
+            CPU_RELAX();
+        }
+
+        Chain all(old_head.ptr, KeepNodes{});
+        if (fifo)
+            all.reverse();
+        return all;
+    }
+
     // Fast empty check (relaxed, may be stale)
     bool empty() const {
         //ABA-10:
@@ -215,26 +378,46 @@ public:
                 //last = last->next.load(std::memory_order_relaxed); 
                 last = new_node; //Faster, no need to load again like last = last->next.load(..)
             }
-        
-            Node* expected_head = _head.load(std::memory_order_relaxed);
-        
-            while (true)
+
+            splice_chain(first, last);
+   } 
+
+private:
+    //StagingBuffer builds private chains of our Node and splices them with splice_chain()
+    template <typename> friend class StagingBuffer;
+
+    // ----------------------------
+    // Splice a private chain first..last onto _head with ONE CAS.
+    // Safe against concurrent push/pop: the chain is invisible to other threads
+    // until the CAS succeeds. The tag is bumped like in push().
+    // Shared by push_bulk_thread_unsafe() and StagingBuffer::flush().
+    // ----------------------------
+    void splice_chain(Node* first, Node* last)
+    {
+        TaggedPtrABA expected_head = _head.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            // Attach existing stack after our chain
+            last->next.store(expected_head.ptr, std::memory_order_relaxed);
+
+            TaggedPtrABA desired(
+                first,
+                expected_head.tag + 1
+            );
+
+            if (_head.compare_exchange_weak(
+                    expected_head,
+                    desired,
+                    std::memory_order_seq_cst, // store half of the Dekker, see emplace()
+                    std::memory_order_relaxed))
             {
-                // Attach existing stack after our chain
-                last->next.store(expected_head, std::memory_order_relaxed);
-        
-                if (_head.compare_exchange_weak(
-                        expected_head,
-                        first,
-                        std::memory_order_release,
-                        std::memory_order_relaxed))
-                {
-                    break;
-                }
-        
-                CPU_RELAX();
+                break;
             }
-   } 
 
-    
+            CPU_RELAX();
+        }
+
+        waiter.notify_all(); // a chain can feed several parked consumers
+    }
 };
@@ -0,0 +1,437 @@
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#define _GNU_SOURCE  // Required for CPU affinity functions
+#include <sched.h>   // Contains cpu_set_t definition
+#include <pthread.h> // Required for pthread_setaffinity_np()
+
+//#include <immintrin.h> // Required for _mm_pause()
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #define CPU_RELAX() _mm_pause()
+
+#elif defined(__aarch64__) || defined(__arm64__)
+    #include <arm_acle.h>
+    #define CPU_RELAX() __yield()
+
+#else
+    #define CPU_RELAX() std::this_thread::yield()
+#endif
+
+#include "Constants.hpp"
+#include "EBRManager.hpp" //For Epoch Based Reclamation (EBR)
+#include "NodeChain.hpp"
+
+/*
+    Runtime-adaptive Treiber stack (Direct <-> Elimination)
+
+    Key idea:
+    - At low load a plain Treiber CAS on head is the cheapest thing we can do.
+    - Under bursts most head CASes fail and every failure bounces the head cache line.
+      A push and a pop that meet in an elimination slot cancel each other out
+      without ever touching head.
+    - The stack samples its own CAS failure rate on head and switches mode:
+
+        Direct      : push/pop retry CAS on head only (same as LockFreeTreiberMPMCStackEBR)
+        Elimination : one CAS on head; on failure try to meet a partner in the
+                      elimination array; on timeout go back to head
+
+    Hysteresis:
+    - Two thresholds (enter > exit), so a failure rate sitting between them never switches.
+    - A new mode must be requested by 'streak' consecutive windows.
+    - Window length and streak default to DEFAULT_SAMPLE_WINDOW / DEFAULT_MODE_SWITCH_STREAK
+      and are tunable with set_sampling(), next to set_thresholds().
+
+    Sampling:
+    - Each thread counts CAS attempts/failures in thread-local counters and only
+      publishes them every SAMPLE_BATCH attempts, so the statistics themselves
+      do not become a new contention point next to head.
+*/
+template <typename T>
+class LockFreeTreiberMPMCStackAdaptive {
+public:
+    enum class Mode : uint8_t
+    {
+        Direct,
+        Elimination
+    };
+
+private:
+    // Thresholds are in per-mille of CAS attempts that failed
+    static constexpr uint32_t DEFAULT_ENTER_ELIMINATION_PERMILLE = 300;
+    static constexpr uint32_t DEFAULT_EXIT_ELIMINATION_PERMILLE  = 50;
+
+    static constexpr uint32_t SAMPLE_BATCH        = 64;   // per-thread attempts before publishing
+    static constexpr uint64_t DEFAULT_SAMPLE_WINDOW      = 4096; // attempts per mode decision
+    static constexpr uint32_t DEFAULT_MODE_SWITCH_STREAK = 2;    // consecutive windows to switch
+
+    static constexpr size_t   ELIMINATION_SLOTS   = 8;
+    static constexpr int      ELIMINATION_SPINS   = 64;   // how long a pusher waits for a partner
+
+    EBRManager ebr;
+
+    struct alignas(CACHE_LINE_SIZE) Node
+    {
+        T data;
+        std::atomic<Node*> next;
+        explicit Node(T const& value) : data(value), next(nullptr) {}
+    };
+
+    // Each slot holds a node offered by a pusher, or nullptr
+    struct alignas(CACHE_LINE_SIZE) EliminationSlot
+    {
+        std::atomic<Node*> offer{nullptr};
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Node*> head{nullptr};
+
+    EliminationSlot elimination[ELIMINATION_SLOTS];
+
+    // Mode + decision state. Read on every operation, written only on a switch.
+    alignas(CACHE_LINE_SIZE) std::atomic<Mode> mode{Mode::Direct};
+    std::atomic<uint32_t> enter_permille{DEFAULT_ENTER_ELIMINATION_PERMILLE};
+    std::atomic<uint32_t> exit_permille{DEFAULT_EXIT_ELIMINATION_PERMILLE};
+    std::atomic<uint64_t> sample_window{DEFAULT_SAMPLE_WINDOW};
+    std::atomic<uint32_t> switch_streak{DEFAULT_MODE_SWITCH_STREAK};
+
+    // Sampling window, written every SAMPLE_BATCH attempts per thread
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> window_attempts{0};
+    std::atomic<uint64_t> window_failures{0};
+    std::atomic<bool> evaluating{false};
+    uint32_t streak = 0; // only touched by the thread holding 'evaluating'
+
+    // Tuning counters (relaxed, read by the benchmark)
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> switches_to_elimination{0};
+    std::atomic<uint64_t> switches_to_direct{0};
+    std::atomic<uint64_t> eliminated_pairs{0};
+
+    // ----------------------------
+    // Thread-local sample
+    // ----------------------------
+    struct ThreadSample
+    {
+        const void* owner = nullptr;
+        uint32_t attempts = 0;
+        uint32_t failures = 0;
+        uint32_t eliminated = 0;
+        uint32_t rng = 0;
+    };
+
+    inline static thread_local ThreadSample sample;
+
+    ThreadSample& local_sample()
+    {
+        if (sample.owner != this)
+        {
+            // Thread switched to another stack instance: drop the foreign counts
+            sample = ThreadSample{};
+            sample.owner = this;
+            sample.rng = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&sample)) | 1u;
+        }
+        return sample;
+    }
+
+    size_t random_slot(ThreadSample& s)
+    {
+        //xorshift32, cheap and thread-local
+        s.rng ^= s.rng << 13;
+        s.rng ^= s.rng >> 17;
+        s.rng ^= s.rng << 5;
+        return s.rng % ELIMINATION_SLOTS;
+    }
+
+    void record_cas(bool failed)
+    {
+        ThreadSample& s = local_sample();
+        ++s.attempts;
+        s.failures += failed;
+
+        if (s.attempts >= SAMPLE_BATCH)
+            publish_sample(s);
+    }
+
+    void publish_sample(ThreadSample& s)
+    {
+        window_failures.fetch_add(s.failures, std::memory_order_relaxed);
+        uint64_t total = window_attempts.fetch_add(s.attempts, std::memory_order_relaxed) + s.attempts;
+
+        if (s.eliminated)
+            eliminated_pairs.fetch_add(s.eliminated, std::memory_order_relaxed);
+
+        s.attempts = 0;
+        s.failures = 0;
+        s.eliminated = 0;
+
+        if (total >= sample_window.load(std::memory_order_relaxed))
+            evaluate_window();
+    }
+
+    // One thread at a time closes a window and decides the mode
+    void evaluate_window()
+    {
+        if (evaluating.exchange(true, std::memory_order_acquire))
+            return; // Someone else is already deciding
+
+        uint64_t attempts = window_attempts.exchange(0, std::memory_order_relaxed);
+        uint64_t failures = window_failures.exchange(0, std::memory_order_relaxed);
+
+        if (attempts >= sample_window.load(std::memory_order_relaxed))
+        {
+            uint64_t rate = (failures * 1000) / attempts;
+            Mode current = mode.load(std::memory_order_relaxed);
+
+            bool wants_switch =
+                (current == Mode::Direct) ? rate >= enter_permille.load(std::memory_order_relaxed)
+                                          : rate <= exit_permille.load(std::memory_order_relaxed);
+
+            streak = wants_switch ? streak + 1 : 0;
+
+            if (streak >= switch_streak.load(std::memory_order_relaxed))
+            {
+                streak = 0;
+                if (current == Mode::Direct)
+                {
+                    mode.store(Mode::Elimination, std::memory_order_relaxed);
+                    switches_to_elimination.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                {
+                    mode.store(Mode::Direct, std::memory_order_relaxed);
+                    switches_to_direct.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        evaluating.store(false, std::memory_order_release);
+    }
+
+    // ----------------------------
+    // Single CAS attempt on head
+    // ----------------------------
+    bool try_push_head(Node* new_node, Node*& expected_head)
+    {
+        new_node->next.store(expected_head, std::memory_order_relaxed);
+        bool ok = head.compare_exchange_weak(expected_head, new_node,
+                    std::memory_order_release,
+                    std::memory_order_relaxed);
+        record_cas(!ok);
+        return ok;
+    }
+
+    // ----------------------------
+    // Elimination: pusher side
+    // Caller must be inside an epoch: a popper retires the node it takes, and the
+    // epoch guarantees that address is not reused while we still compare against it.
+    // ----------------------------
+    bool try_eliminate_push(Node* new_node)
+    {
+        ThreadSample& s = local_sample();
+        EliminationSlot& slot = elimination[random_slot(s)];
+
+        Node* empty = nullptr;
+        if (!slot.offer.compare_exchange_strong(empty, new_node,
+                std::memory_order_release, // publishes new_node->data to the popper
+                std::memory_order_relaxed))
+            return false; // Slot busy, go back to head
+
+        for (int i = 0; i < ELIMINATION_SPINS; ++i)
+        {
+            if (slot.offer.load(std::memory_order_relaxed) != new_node)
+            {
+                ++s.eliminated;
+                return true; // A popper took it
+            }
+            CPU_RELAX();
+        }
+
+        // Timed out: withdraw the offer. If that fails a popper took it in the meantime.
+        Node* expected = new_node;
+        if (slot.offer.compare_exchange_strong(expected, nullptr,
+                std::memory_order_relaxed,
+                std::memory_order_relaxed))
+            return false;
+
+        ++s.eliminated;
+        return true;
+    }
+
+    // ----------------------------
+    // Elimination: popper side (caller is inside an epoch)
+    // ----------------------------
+    bool try_eliminate_pop(T& out)
+    {
+        EliminationSlot& slot = elimination[random_slot(local_sample())];
+
+        Node* offered = slot.offer.load(std::memory_order_relaxed);
+        if (!offered)
+            return false;
+
+        if (!slot.offer.compare_exchange_strong(offered, nullptr,
+                std::memory_order_acquire, // pairs with the pusher's release offer
+                std::memory_order_relaxed))
+            return false;
+
+        // The node never made it onto head: we are its only owner
+        out = offered->data;
+        ebr.retire_node(offered);
+        return true;
+    }
+
+public:
+    LockFreeTreiberMPMCStackAdaptive(const LockFreeTreiberMPMCStackAdaptive&) = delete;
+    LockFreeTreiberMPMCStackAdaptive& operator=(const LockFreeTreiberMPMCStackAdaptive&) = delete;
+    LockFreeTreiberMPMCStackAdaptive(LockFreeTreiberMPMCStackAdaptive&&) = delete;
+    LockFreeTreiberMPMCStackAdaptive& operator=(LockFreeTreiberMPMCStackAdaptive&&) = delete;
+
+    LockFreeTreiberMPMCStackAdaptive() = default;
+
+    void push(T const& value)
+    {
+        Node* new_node = new Node(value);// In HFT, use a memory pool
+        Node* expected_head = head.load(std::memory_order_relaxed);
+
+        if (mode.load(std::memory_order_relaxed) == Mode::Direct)
+        {
+            while (!try_push_head(new_node, expected_head))
+                CPU_RELAX();
+            return;
+        }
+
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        // Elimination mode: head first, partner second, repeat
+        while (!try_push_head(new_node, expected_head))
+        {
+            if (try_eliminate_push(new_node))
+                break;
+            expected_head = head.load(std::memory_order_relaxed);
+        }
+
+        ebr.leave_epoch();
+    }
+
+    //Flow: enter_epoch() -> pop()/eliminate -> retire_node() -> leave_epoch()
+    bool pop(T& out)
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        bool eliminate = mode.load(std::memory_order_relaxed) == Mode::Elimination;
+
+        while (true)
+        {
+            Node* old_head = head.load(std::memory_order_acquire);
+            if (!old_head)
+            {
+                // A pusher may still be waiting in a slot with a value for us
+                bool ok = eliminate && try_eliminate_pop(out);
+                ebr.leave_epoch();
+                return ok;
+            }
+
+            Node* new_head = old_head->next.load(std::memory_order_relaxed);
+            bool ok = head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acq_rel,
+                    std::memory_order_relaxed);
+            record_cas(!ok);
+
+            if (ok)
+            {
+                out = old_head->data;
+                ebr.retire_node(old_head);
+                ebr.leave_epoch(); //NEVER access old_head after leave_epoch()
+                return true;
+            }
+
+            if (eliminate && try_eliminate_pop(out))
+            {
+                ebr.leave_epoch();
+                return true;
+            }
+
+            CPU_RELAX();
+        }
+    }
+
+    // Drain everything with ONE exchange on head, in either mode (same as the
+    // EBR stack). Nodes offered in elimination slots are not on head yet: their
+    // push has not completed, a later pop() or pop_all() gets them.
+    struct RetireNodes
+    {
+        EBRManager* ebr;
+        void operator()(Node* node) const { ebr->retire_node(node); }
+    };
+    using Chain = NodeChain<T, Node, RetireNodes>;
+
+    Chain pop_all(bool fifo = false) {
+        Node* chain = head.exchange(nullptr, std::memory_order_acquire); // pairs with the push CAS
+        Chain all(chain, RetireNodes{&ebr});
+        if (fifo)
+            all.reverse();
+        return all;
+    }
+
+    // Fast empty check (relaxed, may be stale)
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == nullptr;
+    }
+
+    // ----------------------------
+    // Tuning API
+    // ----------------------------
+    Mode current_mode() const
+    {
+        return mode.load(std::memory_order_relaxed);
+    }
+
+    // Failure rates in per-mille (0..1000). enter must be above exit, otherwise it flaps.
+    void set_thresholds(uint32_t enter_elimination_permille, uint32_t exit_elimination_permille)
+    {
+        assert(enter_elimination_permille > exit_elimination_permille);
+        enter_permille.store(enter_elimination_permille, std::memory_order_relaxed);
+        exit_permille.store(exit_elimination_permille, std::memory_order_relaxed);
+    }
+
+    // Mode decision every 'window' CAS attempts (all threads together), a switch
+    // after 'streak' consecutive windows asking for it. Short windows react
+    // faster to a burst, longer ones and a higher streak flap less.
+    void set_sampling(uint64_t window, uint32_t streak_windows)
+    {
+        assert(window >= SAMPLE_BATCH && streak_windows > 0);
+        sample_window.store(window, std::memory_order_relaxed);
+        switch_streak.store(streak_windows, std::memory_order_relaxed);
+    }
+
+    uint64_t mode_switches() const
+    {
+        return switches_to_elimination.load(std::memory_order_relaxed) +
+               switches_to_direct.load(std::memory_order_relaxed);
+    }
+
+    uint64_t elimination_switches() const { return switches_to_elimination.load(std::memory_order_relaxed); }
+    uint64_t direct_switches() const      { return switches_to_direct.load(std::memory_order_relaxed); }
+
+    // Published every SAMPLE_BATCH attempts per thread, so slightly behind
+    uint64_t eliminated() const { return eliminated_pairs.load(std::memory_order_relaxed); }
+
+    //Single threaded when all other threads have joined and stopped using stack. So, memory_order_relaxed
+    ~LockFreeTreiberMPMCStackAdaptive() {
+        for (auto& slot : elimination)
+            delete slot.offer.exchange(nullptr, std::memory_order_relaxed);
+
+        Node* current = head.exchange(nullptr, std::memory_order_relaxed);
+        while (current) {
+           Node* next = current->next.load(std::memory_order_relaxed);
+           delete current;
+           current = next;
+       }
+    }
+};
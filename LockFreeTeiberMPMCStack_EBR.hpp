@@ -6,6 +6,8 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <optional>
+#include <utility>
 #include <cassert>
 #define _GNU_SOURCE  // Required for CPU affinity functions
 #include <sched.h>   // Contains cpu_set_t definition
@@ -26,6 +28,9 @@
 
 #include "Constants.hpp"
 #include "EBRManager.hpp" //For Epoch Based Reclamation (EBR)
+#include "NodeChain.hpp"
+#include "NodeHandle.hpp"
+#include "StackWaiter.hpp"
 
 
 ///Lock-Free Treiber Stack MPMC with EBR (Epoch Based Reclamation)
@@ -35,16 +40,23 @@ private:
 
     //EBR-1: 
     EBRManager ebr;
-    
+
+    // steal_half() looks at most this many nodes of the victim (and takes half of them)
+    static constexpr size_t STEAL_SCAN_LIMIT = 1024;
 
     struct alignas(CACHE_LINE_SIZE) Node 
     {
         T data;
         std::atomic<Node*> next;
-        explicit Node(T const& value) : data(value), next(nullptr) {}
+        // Builds the value in place: push(const&) copies, push(&&) moves, emplace() forwards
+        template <typename... Args>
+        explicit Node(Args&&... args) : data(std::forward<Args>(args)...), next(nullptr) {}
     };
 
     alignas(CACHE_LINE_SIZE) std::atomic<Node*> head{nullptr};  
+
+    // Parked pop_wait() consumers (own cache line, producers only read it)
+    StackWaiter waiter;
     
 public:
     LockFreeTreiberMPMCStackEBR(const LockFreeTreiberMPMCStackEBR&) = delete;
@@ -55,11 +67,19 @@ public:
 
     LockFreeTreiberMPMCStackEBR() = default;  // Default constructor
     
-    //:::TIPS: All memory_order_relaxed except CAS success = memory_order_release ::::::
+    void push(T const& value) { emplace(value); }
+    void push(T&& value) { emplace(std::move(value)); }
+
+    // Constructs the value inside the node: no temporary T, no copy
+    //:::TIPS: All memory_order_relaxed except CAS success = memory_order_seq_cst ::::::
+    //CAS success is seq_cst, not just release: it is the store half of the Dekker
+    //with parked consumers (StackWaiter::wake() needs no fence of its own).
+    //On x86 both are the same LOCK CMPXCHG, on ARMv8 CASAL instead of CASL.
     //NO EBR in PUSH() except in POP()
-    void push(T const& value) 
+    template <typename... Args>
+    void emplace(Args&&... args) 
     {   
-        Node* new_node = new Node(value);// In HFT, use a memory pool        
+        Node* new_node = new Node(std::forward<Args>(args)...);// In HFT, use a memory pool        
         Node* expected_head = head.load(std::memory_order_relaxed); //(A)
 
         //while(expected_head) ==> wont enter loop if the stack is empty (head == nullptr)
@@ -67,7 +87,7 @@ public:
         {
             new_node->next.store(expected_head, std::memory_order_relaxed); //(B)
             if(head.compare_exchange_weak(expected_head, new_node, 
-                    std::memory_order_release, 
+                    std::memory_order_seq_cst, 
                     std::memory_order_relaxed) ) 
             {
                 break; 
@@ -85,11 +105,28 @@ public:
             // expected_head is updated here on every failure
             // loop retries with the new value
         }
+
+        waiter.notify_one(); // no syscall unless a consumer is parked
     }
   
+    // Moves the value out of the node: move-only T (std::unique_ptr) works, a big T is not copied
+    bool pop(T& out) {
+        return pop_into([&out](T& data) { out = std::move(data); });
+    }
+
+    // Same, for a T that is not default-constructible
+    std::optional<T> try_pop() {
+        std::optional<T> result;
+        pop_into([&result](T& data) { result.emplace(std::move(data)); });
+        return result;
+    }
+
+    // take(T&) runs on the popped value while the node is still ours (before it
+    // is retired), so the value can be consumed in place without a copy or move
     //:::TIPS: acquire->relaxed->acquire->relaxed ::::::
     //Flow: enter_epoch() -> pop() -> retire_node() -> leave_epoch()
-    bool pop(T& out) {
+    template <typename Take>
+    bool pop_into(Take&& take) {
 
         //EBR-2:
         ebr.init_thread();   // once per thread
@@ -111,7 +148,7 @@ public:
                     std::memory_order_acq_rel, 
                     std::memory_order_relaxed)) 
              {
-                out = old_head->data;
+                take(old_head->data);
 
                  //EBR-4:  
                  //delete old_head;
@@ -126,6 +163,232 @@ public:
         return false; //Unreachable code, no need for ebr.leave_epoch();
     }
 
+    // Blocking pop: spin briefly, then park on a futex until a push arrives.
+    // push() wakes only when someone is parked (see StackWaiter).
+    // Returns false once the stack is closed AND drained.
+    bool pop_wait(T& out) {
+        return waiter.wait([&]() { return pop(out); });
+    }
+
+    // Deadline-bounded pop_wait(): PopResult::TimedOut if nothing arrived in time,
+    // PopResult::Closed once closed and drained.
+    // Spins min(spin window, time left), then parks with a futex timeout.
+    template <typename Clock, typename Duration>
+    PopResult try_pop_until(T& out, std::chrono::time_point<Clock, Duration> const& deadline) {
+        return waiter.wait_until([&]() { return pop(out); }, deadline);
+    }
+
+    template <typename Rep, typename Period>
+    PopResult try_pop_for(T& out, std::chrono::duration<Rep, Period> const& timeout) {
+        return try_pop_until(out, std::chrono::steady_clock::now() + timeout);
+    }
+
+    // Shutdown: wakes every blocked consumer, they drain what is left and then
+    // pop_wait() returns false. Producers must stop pushing before close().
+    void close() {
+        waiter.close();
+    }
+
+    bool closed() const {
+        return waiter.closed();
+    }
+
+    // epoll integration: an eventfd that turns readable when elements arrive
+    // (one write per burst, see StackWaiter). Call before the stack is shared.
+    // Loop: fd readable -> ack_event() -> pop() until it fails.
+    int enable_eventfd() {
+        int fd = waiter.enable_eventfd();
+        if (fd >= 0 && !empty())
+            waiter.notify_all(); // already has elements: readable right away
+        return fd;
+    }
+
+    int event_fd() const {
+        return waiter.eventfd_handle();
+    }
+
+    void ack_event() {
+        waiter.ack_event();
+    }
+
+    // Batch pop: up to n values into out[0..k), returns k (0 if empty).
+    // ONE epoch and ONE CAS on head for the whole batch, out[0] is the old top.
+    //Flow: enter_epoch() -> walk n nodes -> CAS head past them -> retire -> leave_epoch()
+    size_t pop_bulk(T* out, size_t n) {
+
+        if (n == 0)
+            return 0;
+
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        while (true) {
+
+            Node* old_head = head.load(std::memory_order_acquire);
+            if (!old_head)
+            {
+                ebr.leave_epoch();
+                return 0;
+            }
+
+            // Walk is safe inside the epoch: no node reachable from old_head can be freed
+            // before leave_epoch(), and popped nodes are never pushed again, so if head is
+            // still old_head at the CAS, the chain below it is the one we walked.
+            Node* last = old_head;
+            size_t count = 1;
+            while (count < n)
+            {
+                Node* next = last->next.load(std::memory_order_relaxed);
+                if (!next)
+                    break;
+                last = next;
+                ++count;
+            }
+
+            Node* new_head = last->next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acq_rel,
+                    std::memory_order_relaxed))
+            {
+                Node* node = old_head;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    out[i] = std::move(node->data);
+                    node = node->next.load(std::memory_order_relaxed);
+                }
+
+                // The batch is detached and only we will retire it, so it stays valid
+                // after leave_epoch(). Retiring outside our own epoch lets the
+                // retire_node() calls actually reclaim instead of rescanning a list
+                // our active epoch pins.
+                ebr.leave_epoch();
+                retire_chain(old_head, count);
+                return count;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    // Load balancing: move roughly half of victim's elements onto this stack.
+    // ONE CAS on victim's head, ONE splice CAS on ours. Returns how many moved.
+    //
+    // Bounded walk inside one epoch: count up to STEAL_SCAN_LIMIT nodes while a second
+    // pointer trails at half speed, so the cut point is found in a single pass.
+    // The values are copied into fresh nodes and the victim's nodes are retired.
+    // Relinking them instead would put popped nodes back on a head, where a stale
+    // popper could still CAS them (ABA): pop() and pop_bulk() rely on that never happening.
+    size_t steal_half(LockFreeTreiberMPMCStackEBR& victim) {
+
+        if (&victim == this)
+            return 0;
+
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        while (true) {
+
+            Node* old_head = victim.head.load(std::memory_order_acquire);
+            if (!old_head)
+            {
+                ebr.leave_epoch();
+                return 0;
+            }
+
+            Node* cut = old_head; // last node we take
+            size_t taken = 1;
+            size_t seen = 1;
+            for (Node* scan = old_head->next.load(std::memory_order_relaxed);
+                 scan && seen < STEAL_SCAN_LIMIT;
+                 scan = scan->next.load(std::memory_order_relaxed))
+            {
+                // take (seen + 1) / 2
+                if (++seen % 2 == 1)
+                {
+                    // Links can change under a stale walk (nodes moved on); the CAS below
+                    // then fails, we just must not run off the end
+                    Node* next = cut->next.load(std::memory_order_relaxed);
+                    if (!next)
+                        break;
+                    cut = next;
+                    ++taken;
+                }
+            }
+
+            Node* new_head = cut->next.load(std::memory_order_relaxed);
+            if (victim.head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acq_rel,
+                    std::memory_order_relaxed))
+            {
+                // Same order on our side: the victim's top stays our top
+                Node* first = nullptr;
+                Node* last = nullptr;
+                Node* node = old_head;
+                for (size_t i = 0; i < taken; ++i)
+                {
+                    Node* copy = new Node(std::move(node->data));
+                    if (last)
+                        last->next.store(copy, std::memory_order_relaxed);
+                    else
+                        first = copy;
+                    last = copy;
+                    node = node->next.load(std::memory_order_relaxed);
+                }
+
+                ebr.leave_epoch(); // detached and ours, see pop_bulk()
+                retire_chain(old_head, taken);
+
+                splice_chain(first, last);
+                return taken;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    // Drain everything with ONE exchange on head. No epoch needed: the chain is
+    // private from here on. The range retires the nodes when it dies, because a
+    // concurrent pop() may still hold one it loaded before the exchange.
+    // fifo = true: oldest push first.
+    struct RetireNodes
+    {
+        EBRManager* ebr;
+        void operator()(Node* node) const { ebr->retire_node(node); }
+    };
+    using Chain = NodeChain<T, Node, RetireNodes>;
+
+    Chain pop_all(bool fifo = false) {
+        Node* chain = head.exchange(nullptr, std::memory_order_acquire); // pairs with push()'s release CAS
+        Chain all(chain, RetireNodes{&ebr});
+        if (fifo)
+            all.reverse();
+        return all;
+    }
+
+    // Zero-copy pop: the top node itself, its payload read/written in place.
+    // The handle retires the node when it dies (or on reset()).
+    //Flow: enter_epoch() -> CAS head past the top -> leave_epoch() -> ... -> ~Handle() retires
+    using Handle = NodeHandle<T, Node, RetireNodes>;
+
+    Handle pop_handle() {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        Node* old_head = head.load(std::memory_order_acquire);
+        while (old_head)
+        {
+            Node* new_head = old_head->next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acq_rel,
+                    std::memory_order_acquire))
+            {
+                break;
+            }
+            CPU_RELAX();
+        }
+
+        ebr.leave_epoch(); // detached and ours, see pop_bulk(): only the handle retires it
+        return old_head ? Handle(old_head, RetireNodes{&ebr}) : Handle();
+    }
+
     // Fast empty check (relaxed, may be stale)
     bool empty() const {
         return head.load(std::memory_order_acquire) == nullptr;
@@ -159,26 +422,56 @@ public:
                 //last = last->next.load(std::memory_order_relaxed); 
                 last = new_node; //Faster, no need to load again like last = last->next.load(..)
             }
-        
-            Node* expected_head = head.load(std::memory_order_relaxed);
-        
-            while (true)
+
+            splice_chain(first, last);
+   } 
+
+private:
+    //StagingBuffer builds private chains of our Node and splices them with splice_chain()
+    template <typename> friend class StagingBuffer;
+    //LockFreeBag stores our Node in its chunk slots (next unused there)
+    template <typename, size_t> friend class LockFreeBag;
+
+    // ----------------------------
+    // Retire 'count' detached nodes starting at first
+    // ----------------------------
+    void retire_chain(Node* first, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            Node* next = first->next.load(std::memory_order_relaxed);
+            ebr.retire_node(first);
+            first = next;
+        }
+    }
+
+    // ----------------------------
+    // Splice a private chain first..last onto head with ONE CAS.
+    // Safe against concurrent push/pop: the chain is invisible to other threads
+    // until the CAS succeeds.
+    // Shared by push_bulk_thread_unsafe() and StagingBuffer::flush().
+    // ----------------------------
+    void splice_chain(Node* first, Node* last)
+    {
+        Node* expected_head = head.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            // Attach existing stack after our chain
+            last->next.store(expected_head, std::memory_order_relaxed);
+
+            if (head.compare_exchange_weak(
+                    expected_head,
+                    first,
+                    std::memory_order_seq_cst, // release + the store half of the waiter Dekker (see StackWaiter)
+                    std::memory_order_relaxed))
             {
-                // Attach existing stack after our chain
-                last->next.store(expected_head, std::memory_order_relaxed);
-        
-                if (head.compare_exchange_weak(
-                        expected_head,
-                        first,
-                        std::memory_order_release,
-                        std::memory_order_relaxed))
-                {
-                    break;
-                }
-        
-                CPU_RELAX();
+                break;
             }
-   } 
 
-    
+            CPU_RELAX();
+        }
+
+        waiter.notify_all(); // a chain can feed several parked consumers
+    }
 };
@@ -6,6 +6,8 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <optional>
+#include <utility>
 #include <cassert>
 #define _GNU_SOURCE  // Required for CPU affinity functions
 #include <sched.h>   // Contains cpu_set_t definition
@@ -13,6 +15,9 @@
 
 #include "HazardPointerManager.hpp"
 #include "Constants.hpp"
+#include "NodeChain.hpp"
+#include "NodeHandle.hpp"
+#include "StackWaiter.hpp"
 
 //#include <immintrin.h> // Required for _mm_pause()
 #if defined(__x86_64__) || defined(_M_X64)
@@ -40,11 +45,16 @@ private:
     {
         T data;
         std::atomic<Node*> next;
-        explicit Node(T const& value) : data(value), next(nullptr) {}
+        // Builds the value in place: push(const&) copies, push(&&) moves, emplace() forwards
+        template <typename... Args>
+        explicit Node(Args&&... args) : data(std::forward<Args>(args)...), next(nullptr) {}
     };
 
     alignas(CACHE_LINE_SIZE) std::atomic<Node*> head{nullptr};  
 
+    // Parked pop_wait() consumers (own cache line, producers only read it)
+    StackWaiter waiter;
+
     
 public:
     LockFreeTreiberMPMCStackHazardPointer(const LockFreeTreiberMPMCStackHazardPointer&) = delete;
@@ -55,10 +65,18 @@ public:
 
     LockFreeTreiberMPMCStackHazardPointer() = default;  // Default constructor
     
-    //:::TIPS: All memory_order_relaxed except CAS success = memory_order_release ::::::
-    void push(T const& value) { 
+    void push(T const& value) { emplace(value); }
+    void push(T&& value) { emplace(std::move(value)); }
+
+    // Constructs the value inside the node: no temporary T, no copy
+    //:::TIPS: All memory_order_relaxed except CAS success = memory_order_seq_cst ::::::
+    //CAS success is seq_cst, not just release: it is the store half of the Dekker
+    //with parked consumers (StackWaiter::wake() needs no fence of its own).
+    //On x86 both are the same LOCK CMPXCHG, on ARMv8 CASAL instead of CASL.
+    template <typename... Args>
+    void emplace(Args&&... args) { 
         
-        Node* new_node = new Node(value);// In HFT, use a memory pool
+        Node* new_node = new Node(std::forward<Args>(args)...);// In HFT, use a memory pool
         Node* expected_head = head.load(std::memory_order_relaxed); //(A)
 
         //while(expected_head) ==> wont enter loop if the stack is empty (head == nullptr)
@@ -67,7 +85,7 @@ public:
             new_node->next.store(expected_head, std::memory_order_relaxed); //(B)
           
             if(head.compare_exchange_weak(expected_head, new_node, 
-                    std::memory_order_release, // (C) => (C) will push (A) & (B) above to memory.
+                    std::memory_order_seq_cst, // (C) => (C) will push (A) & (B) above to memory.
                                                //A->B->C will be visible to other threads which use acquire to read//Successful CAS will release the new_node                
                     std::memory_order_relaxed) //1. On CAS failure, expected_head is atomically updated
                                                //   with the current value of head.
@@ -99,6 +117,8 @@ public:
             // expected_head is updated here on every failure
             // loop retries with the new value
         }
+
+        waiter.notify_one(); // no syscall unless a consumer is parked
     }
 
     /*
@@ -111,8 +131,23 @@ public:
     success → retire
     failure → retry
     */
-    //:::TIPS: acquire->relaxed->acquire->relaxed ::::::
+    // Moves the value out of the node: move-only T (std::unique_ptr) works, a big T is not copied
     bool pop(T& out) {
+        return pop_into([&out](T& data) { out = std::move(data); });
+    }
+
+    // Same, for a T that is not default-constructible
+    std::optional<T> try_pop() {
+        std::optional<T> result;
+        pop_into([&result](T& data) { result.emplace(std::move(data)); });
+        return result;
+    }
+
+    // take(T&) runs on the popped value while the node is still ours (before it
+    // is retired), so the value can be consumed in place without a copy or move
+    //:::TIPS: acquire->relaxed->acquire->relaxed ::::::
+    template <typename Take>
+    bool pop_into(Take&& take) {
         
         hp.init_thread();   // once per pop invocation (or per thread)
         
@@ -133,7 +168,7 @@ public:
                     std::memory_order_acq_rel, 
                     std::memory_order_relaxed)) 
              {
-                out = old_head->data;
+                take(old_head->data);
 
                 //delete old_head
                 // Hazard Pointer-3:
@@ -152,6 +187,179 @@ public:
         return false;
     }
 
+    // Blocking pop: spin briefly, then park on a futex until a push arrives.
+    // push() wakes only when someone is parked (see StackWaiter).
+    // Returns false once the stack is closed AND drained.
+    bool pop_wait(T& out) {
+        return waiter.wait([&]() { return pop(out); });
+    }
+
+    // Deadline-bounded pop_wait(): PopResult::TimedOut if nothing arrived in time,
+    // PopResult::Closed once closed and drained.
+    // Spins min(spin window, time left), then parks with a futex timeout.
+    template <typename Clock, typename Duration>
+    PopResult try_pop_until(T& out, std::chrono::time_point<Clock, Duration> const& deadline) {
+        return waiter.wait_until([&]() { return pop(out); }, deadline);
+    }
+
+    template <typename Rep, typename Period>
+    PopResult try_pop_for(T& out, std::chrono::duration<Rep, Period> const& timeout) {
+        return try_pop_until(out, std::chrono::steady_clock::now() + timeout);
+    }
+
+    // Shutdown: wakes every blocked consumer, they drain what is left and then
+    // pop_wait() returns false. Producers must stop pushing before close().
+    void close() {
+        waiter.close();
+    }
+
+    bool closed() const {
+        return waiter.closed();
+    }
+
+    // epoll integration: an eventfd that turns readable when elements arrive
+    // (one write per burst, see StackWaiter). Call before the stack is shared.
+    // Loop: fd readable -> ack_event() -> pop() until it fails.
+    int enable_eventfd() {
+        int fd = waiter.enable_eventfd();
+        if (fd >= 0 && !empty())
+            waiter.notify_all(); // already has elements: readable right away
+        return fd;
+    }
+
+    int event_fd() const {
+        return waiter.eventfd_handle();
+    }
+
+    void ack_event() {
+        waiter.ack_event();
+    }
+
+    // Batch pop: up to n values into out[0..k), returns k (0 if empty).
+    // ONE CAS on head for the whole batch, out[0] is the old top.
+    //
+    // Hand-over-hand protection with two hazard slots:
+    //   slot 0 : old_head, for the whole attempt
+    //   slot 1 : the node being stepped onto
+    // After each hazard store, re-check head == old_head. While old_head is still on
+    // top, nothing below it was popped (popped nodes are never pushed again), so the
+    // node just protected was still linked when its hazard became visible and no
+    // reclaimer can free it. The seq_cst fence pairs with the one in reclaim().
+    // If head moved, restart: the walk may be on a stale chain.
+    size_t pop_bulk(T* out, size_t n) {
+
+        if (n == 0)
+            return 0;
+
+        hp.init_thread();
+
+        while (true) {
+
+            Node* old_head = head.load(std::memory_order_acquire);
+            if (!old_head)
+            {
+                hp.clear_hazard();
+                return 0;
+            }
+
+            hp.set_hazard(old_head, 0);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (head.load(std::memory_order_acquire) != old_head)
+                continue;
+
+            // new_head is always read while the node it hangs off is protected
+            size_t count = 1;
+            Node* new_head = old_head->next.load(std::memory_order_relaxed);
+            bool stale = false;
+            while (count < n && new_head)
+            {
+                hp.set_hazard(new_head, 1);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (head.load(std::memory_order_acquire) != old_head)
+                {
+                    stale = true;
+                    break;
+                }
+                ++count;
+                new_head = new_head->next.load(std::memory_order_relaxed);
+            }
+            if (stale)
+                continue;
+
+            if (head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acq_rel,
+                    std::memory_order_relaxed))
+            {
+                // The batch is ours now, no other thread can reach it
+                hp.clear_hazard();
+
+                Node* node = old_head;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    Node* next = node->next.load(std::memory_order_relaxed);
+                    out[i] = std::move(node->data);
+                    hp.retire_node(node);
+                    node = next;
+                }
+                return count;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    // Drain everything with ONE exchange on head. No hazard needed: the chain is
+    // private from here on. The range retires the nodes when it dies, because a
+    // concurrent pop() may still hold a hazard on one it loaded before the exchange.
+    // fifo = true: oldest push first.
+    struct RetireNodes
+    {
+        HazardPointerManager* hp;
+        void operator()(Node* node) const { hp->retire_node(node); }
+    };
+    using Chain = NodeChain<T, Node, RetireNodes>;
+
+    Chain pop_all(bool fifo = false) {
+        Node* chain = head.exchange(nullptr, std::memory_order_acquire); // pairs with push()'s release CAS
+        Chain all(chain, RetireNodes{&hp});
+        if (fifo)
+            all.reverse();
+        return all;
+    }
+
+    // Zero-copy pop: the top node itself, its payload read/written in place.
+    // The handle retires the node when it dies (or on reset()).
+    // Hazard protocol as in pop_bulk(): protect, fence, re-check head, then CAS.
+    using Handle = NodeHandle<T, Node, RetireNodes>;
+
+    Handle pop_handle() {
+        hp.init_thread();
+
+        while (true) {
+
+            Node* old_head = head.load(std::memory_order_acquire);
+            if (!old_head)
+            {
+                hp.clear_hazard();
+                return Handle();
+            }
+
+            hp.set_hazard(old_head, 0);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (head.load(std::memory_order_acquire) != old_head)
+                continue;
+
+            Node* new_head = old_head->next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acq_rel,
+                    std::memory_order_relaxed))
+            {
+                hp.clear_hazard(); // ours now, no other thread can reach it
+                return Handle(old_head, RetireNodes{&hp});
+            }
+            CPU_RELAX();
+        }
+    }
+
     // Fast empty check (relaxed, may be stale)
     bool empty() const {
         return head.load(std::memory_order_acquire) == nullptr;
@@ -194,26 +402,41 @@ public:
                 //last = last->next.load(std::memory_order_relaxed); 
                 last = new_node; //Faster, no need to load again like last = last->next.load(..)
             }
-        
-            Node* expected_head = head.load(std::memory_order_relaxed);
-        
-            while (true)
+
+            splice_chain(first, last);
+   } 
+
+private:
+    //StagingBuffer builds private chains of our Node and splices them with splice_chain()
+    template <typename> friend class StagingBuffer;
+
+    // ----------------------------
+    // Splice a private chain first..last onto head with ONE CAS.
+    // Safe against concurrent push/pop: the chain is invisible to other threads
+    // until the CAS succeeds.
+    // Shared by push_bulk_thread_unsafe() and StagingBuffer::flush().
+    // ----------------------------
+    void splice_chain(Node* first, Node* last)
+    {
+        Node* expected_head = head.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            // Attach existing stack after our chain
+            last->next.store(expected_head, std::memory_order_relaxed);
+
+            if (head.compare_exchange_weak(
+                    expected_head,
+                    first,
+                    std::memory_order_seq_cst, // release + the store half of the waiter Dekker (see StackWaiter)
+                    std::memory_order_relaxed))
             {
-                // Attach existing stack after our chain
-                last->next.store(expected_head, std::memory_order_relaxed);
-        
-                if (head.compare_exchange_weak(
-                        expected_head,
-                        first,
-                        std::memory_order_release,
-                        std::memory_order_relaxed))
-                {
-                    break;
-                }
-        
-                CPU_RELAX();
+                break;
             }
-   } 
 
-    
+            CPU_RELAX();
+        }
+
+        waiter.notify_all(); // a chain can feed several parked consumers
+    }
 };
@@ -32,15 +32,43 @@ void pinThreadToCore(int threadIndex, int numaNode) {
     */
 }
 
+#include <array>
 #include <iostream>
 #include <thread>
 #include <vector>
 #include <chrono>
+#include <set>
+#include <random>
+#include <algorithm>
+#include <memory> // unique_ptr payloads
+#include <optional>
+#include <type_traits> // is_trivially_copyable_v
+#include <cstdlib> // malloc
+#include <cstring> // memset
+#include <ctime> // clock_gettime(CLOCK_THREAD_CPUTIME_ID)
+#if defined(__linux__)
+    #include <sys/epoll.h>
+#endif
 
 #include "LockFreeTreiberMPMCStack.hpp"
 #include "LockFreeTreiberMPMCStack_ABA.hpp"
 #include "LockFreeTreiberMPMCStack_EBR.hpp"
 #include "LockFreeTreiberMPMCStack_HazardPointer.hpp"
+#include "LockFreeTeiberMPMCStack_Adaptive.hpp"
+#include "ShardedStack.hpp"
+#include "RelaxedStack.hpp"
+#include "TimestampedStack.hpp"
+#include "PerCpuStack.hpp"
+#include "AsyncStack.hpp" // empty unless C++20 coroutines
+#include "StagingBuffer.hpp"
+#include "BoundedStack.hpp"
+#include "ArrayStack.hpp"
+#include "SegmentedStack.hpp"
+#include "PriorityStack.hpp"
+#include "ObjectPool.hpp"
+#include "BufferPool.hpp"
+#include "LockFreeBag.hpp"
+#include "CardinalityStack.hpp"
 
 using namespace std;
 using namespace std::chrono;
@@ -71,69 +99,1636 @@ void measure(const std::string& name, F&& func)
     //return duration;
 }
 
+// --------------------------------------------
+// Per-variant statistics printed after a run.
+// Default: nothing to report.
+// --------------------------------------------
+template <typename Stack>
+void report_stats(const string&, const Stack&)
+{
+}
+
+template <typename T>
+void report_stats(const string& name, const LockFreeTreiberMPMCStackAdaptive<T>& stack)
+{
+    cout << name << " mode: "
+         << (stack.current_mode() == LockFreeTreiberMPMCStackAdaptive<T>::Mode::Direct ? "Direct" : "Elimination")
+         << " | switches: " << stack.mode_switches()
+         << " (to elimination " << stack.elimination_switches()
+         << ", to direct " << stack.direct_switches() << ")"
+         << " | eliminated pairs: " << stack.eliminated() << "\n";
+}
+
+template <typename T, size_t NUM_SHARDS, typename Stack>
+void report_stats(const string& name, const ShardedStack<T, NUM_SHARDS, Stack>& stack)
+{
+    cout << name << " steals: " << stack.steals() << "\n";
+}
+
+// --------------------------------------------
+// Consumer phase shared by the runners:
+// NUM_CONSUMERS threads pop until the stack looks empty
+// --------------------------------------------
+template <typename Stack>
+void run_pop_phase(const string& name, Stack& stack)
+{
+    vector<thread> threads;
+    threads.reserve(NUM_CONSUMERS);
+
+    measure(name + " (pop phase)", [&]()
+    {
+        for (int i = 0; i < NUM_CONSUMERS; ++i)
+        {
+            threads.emplace_back([i, &stack]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+
+                int value;
+
+                while (true)
+                {
+                    if (!stack.pop(value))
+                        break;
+                }
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+    });
+}
+
+// --------------------------------------------
+// Producer phase shared by the runners:
+// NUM_PRODUCERS threads push WORKLOAD values each
+// --------------------------------------------
+template <typename Stack>
+void run_push_phase(const string& name, Stack& stack)
+{
+    vector<thread> threads;
+    threads.reserve(NUM_PRODUCERS);
+
+    measure(name + " (push phase)", [&]()
+    {
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            threads.emplace_back([i, &stack]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                for (int j = 0; j < WORKLOAD; ++j)
+                {
+                    stack.push(j);
+                }
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+    });
+}
+
 // --------------------------------------------
 // Generic test runner
 // --------------------------------------------
 template <typename Stack>
-void run_test(const string& name)
+void run_test(const string& name)
+{
+    Stack stack;
+
+    // -----------------------------
+    // PRODUCERS
+    // -----------------------------
+    run_push_phase(name, stack);
+
+    // -----------------------------
+    // CONSUMERS
+    // -----------------------------
+    run_pop_phase(name, stack);
+
+    report_stats(name, stack);
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Adaptive stack under a burst that should flip it, then a quiet tail that
+// should flip it back. run_test() cannot: its pushes and pops run in separate
+// phases (no partner to eliminate with) and see too few CAS failures.
+//   burst: all threads start together, each alternates push / pop
+//   quiet: one thread alternates push / pop, no CAS can fail
+// Checks that every pushed value came out once (sum) and that the mode
+// switch and the elimination path were actually exercised.
+// --------------------------------------------
+template <typename Configure>
+void run_adaptive_contention_test(const string& name, uint64_t window, Configure&& configure)
+{
+    using Stack = LockFreeTreiberMPMCStackAdaptive<int>;
+    Stack stack;
+    stack.set_sampling(window, 1);
+    configure(stack);
+
+    const int threads_count = NUM_PRODUCERS + NUM_CONSUMERS;
+    const int rounds = WORKLOAD * 16;
+    std::atomic<long long> popped_sum{0};
+    std::atomic<bool> go{false};
+    vector<thread> threads;
+
+    measure(name + " (burst phase)", [&]()
+    {
+        for (int i = 0; i < threads_count; ++i)
+            threads.emplace_back([i, &stack, &popped_sum, &go, rounds]()
+            {
+                pinThreadToCore(i, i < NUM_PRODUCERS ? NUMA_NODE_0 : NUMA_NODE_1);
+                while (!go.load(std::memory_order_acquire))
+                    CPU_RELAX();
+
+                long long local = 0;
+                int value;
+                for (int j = 0; j < rounds; ++j)
+                {
+                    stack.push(j);
+                    if (stack.pop(value))
+                        local += value;
+                }
+                popped_sum.fetch_add(local, std::memory_order_relaxed);
+            });
+        go.store(true, std::memory_order_release);
+        for (auto& t : threads)
+            t.join();
+    });
+    uint64_t to_elimination = stack.elimination_switches();
+    uint64_t eliminated = stack.eliminated();
+
+    measure(name + " (quiet phase)", [&]()
+    {
+        long long local = 0;
+        int value;
+        for (uint64_t j = 0; j < 8 * window; ++j)
+        {
+            stack.push(static_cast<int>(j));
+            if (stack.pop(value))
+                local += value;
+        }
+        while (stack.pop(value))
+            local += value;
+        popped_sum.fetch_add(local, std::memory_order_relaxed);
+    });
+
+    long long quiet_sum = static_cast<long long>(8 * window) * (8 * window - 1) / 2;
+    long long expected = static_cast<long long>(threads_count) * rounds * (rounds - 1) / 2 + quiet_sum;
+    report_stats(name, stack);
+    cout << name << " popped sum " << popped_sum.load()
+         << (popped_sum.load() == expected ? " (ok)\n" : " (MISMATCH)\n");
+    cout << name << " burst: switches to elimination " << to_elimination
+         << ", eliminated pairs " << eliminated
+         << (to_elimination > 0 && eliminated > 0 ? " (exercised)\n" : " (NOT EXERCISED: too little contention)\n");
+    cout << name << " quiet: switches back to direct " << stack.direct_switches()
+         << (stack.direct_switches() > 0 ? " (exercised)\n" : " (NOT EXERCISED)\n");
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Fixed-capacity stacks: same phases as run_test, sized for the whole workload
+// --------------------------------------------
+template <typename Stack>
+void run_capacity_test(const string& name, size_t capacity)
+{
+    Stack stack(capacity);
+
+    run_push_phase(name, stack);
+    run_pop_phase(name, stack);
+
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Staged producers: every producer write-combines its pushes in a
+// StagingBuffer and splices them onto head with one CAS per 'threshold'
+// --------------------------------------------
+template <typename Stack>
+void run_staged_test(const string& name, size_t threshold)
+{
+    Stack stack;
+
+    vector<thread> threads;
+    threads.reserve(NUM_PRODUCERS);
+
+    measure(name + " (staged push phase)", [&]()
+    {
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            threads.emplace_back([i, &stack, threshold]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                StagingBuffer<Stack> buffer(stack, threshold);
+                for (int j = 0; j < WORKLOAD; ++j)
+                {
+                    buffer.push(j);
+                }
+                // ~StagingBuffer() flushes the tail
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+    });
+
+    run_pop_phase(name, stack);
+
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Batch consumers: every consumer drains with pop_bulk(), one head CAS
+// (and one epoch / hazard walk) per 'batch' elements
+// --------------------------------------------
+template <typename Stack>
+void run_bulk_pop_test(const string& name, size_t batch)
+{
+    Stack stack;
+
+    run_push_phase(name, stack);
+
+    vector<thread> threads;
+    threads.reserve(NUM_CONSUMERS);
+
+    measure(name + " (bulk pop phase)", [&]()
+    {
+        for (int i = 0; i < NUM_CONSUMERS; ++i)
+        {
+            threads.emplace_back([i, &stack, batch]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+
+                vector<int> values(batch);
+
+                while (true)
+                {
+                    if (stack.pop_bulk(values.data(), batch) == 0)
+                        break;
+                }
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+    });
+
+    cout << name << " completed\n\n";
+}
+
+// pop_all() gives one chain, or one chain per shard / head (ShardedStack, RelaxedStack).
+// Adds the values to 'sum', returns how many there were.
+template <typename T, typename Node, typename Dispose>
+size_t add_drained(NodeChain<T, Node, Dispose> const& chain, long long& sum)
+{
+    size_t n = 0;
+    for (int value : chain)
+    {
+        sum += value;
+        ++n;
+    }
+    return n;
+}
+
+template <typename Chain, size_t N>
+size_t add_drained(std::array<Chain, N> const& chains, long long& sum)
+{
+    size_t n = 0;
+    for (auto const& chain : chains)
+        n += add_drained(chain, sum);
+    return n;
+}
+
+// --------------------------------------------
+// Drain-all consumers: every consumer takes whatever is there with one
+// head exchange (per shard / head) and walks it privately (FIFO when 'fifo')
+// --------------------------------------------
+template <typename Stack>
+void run_pop_all_test(const string& name, bool fifo)
+{
+    Stack stack;
+
+    run_push_phase(name, stack);
+
+    vector<thread> threads;
+    threads.reserve(NUM_CONSUMERS);
+    std::atomic<long long> drained{0};
+
+    measure(name + " (pop_all phase)", [&]()
+    {
+        for (int i = 0; i < NUM_CONSUMERS; ++i)
+        {
+            threads.emplace_back([i, &stack, &drained, fifo]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+
+                long long local = 0;
+
+                while (true)
+                {
+                    auto all = stack.pop_all(fifo);
+                    if (add_drained(all, local) == 0)
+                        break;
+                }
+                drained.fetch_add(local, std::memory_order_relaxed);
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+    });
+
+    long long expected = static_cast<long long>(NUM_PRODUCERS) * WORKLOAD * (WORKLOAD - 1) / 2;
+    cout << name << " drained sum " << drained.load() << (drained.load() == expected ? " (ok)\n" : " (MISMATCH)\n");
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Work distribution: producers fill one shared stack, every consumer drains
+// its OWN stack and refills it from the shared one when it runs dry.
+//   half = true : steal_half(), one victim CAS moves half the shared stack
+//   half = false: one pop() per stolen element
+// --------------------------------------------
+template <typename Stack>
+void run_steal_test(const string& name, bool half)
+{
+    Stack shared;
+
+    run_push_phase(name, shared);
+
+    vector<thread> threads;
+    threads.reserve(NUM_CONSUMERS);
+    std::atomic<uint64_t> steal_ops{0};
+
+    measure(name + " (steal phase)", [&]()
+    {
+        for (int i = 0; i < NUM_CONSUMERS; ++i)
+        {
+            threads.emplace_back([i, &shared, &steal_ops, half]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+
+                Stack local;
+                int value;
+                uint64_t steals = 0;
+
+                while (true)
+                {
+                    if (local.pop(value))
+                        continue;
+
+                    ++steals;
+                    if (half)
+                    {
+                        if (local.steal_half(shared) == 0)
+                            break;
+                    }
+                    else if (!shared.pop(value))
+                    {
+                        break;
+                    }
+                }
+                steal_ops.fetch_add(steals, std::memory_order_relaxed);
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+    });
+
+    cout << name << " steal operations: " << steal_ops.load() << "\n";
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Blocking consumers: consumers start FIRST on an empty stack and run until
+// the stack is closed and drained; producers push in bursts with idle gaps,
+// then close() ends the run (no element counts, no sentinels).
+//   blocking = true : pop_wait() (spin, then park on the futex)
+//   blocking = false: spin on pop() with CPU_RELAX, polling closed()
+// Reports the CPU time the consumers burned and the close() -> all exited time.
+// --------------------------------------------
+static double thread_cpu_ms()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+template <typename Stack>
+void run_blocking_test(const string& name, bool blocking)
+{
+    static constexpr int BURST = 100;
+    static constexpr auto IDLE_GAP = microseconds(200);
+
+    Stack stack;
+
+    vector<thread> consumers;
+    vector<thread> producers;
+    consumers.reserve(NUM_CONSUMERS);
+    producers.reserve(NUM_PRODUCERS);
+    std::atomic<double> consumer_cpu_ms{0};
+    std::atomic<int> popped{0};
+    steady_clock::duration shutdown{};
+
+    measure(name + " (burst phase)", [&]()
+    {
+        for (int i = 0; i < NUM_CONSUMERS; ++i)
+        {
+            consumers.emplace_back([i, &stack, &consumer_cpu_ms, &popped, blocking]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+
+                int value;
+                int count = 0;
+                while (true)
+                {
+                    if (blocking)
+                    {
+                        if (!stack.pop_wait(value))
+                            break; // closed and drained
+                    }
+                    else if (!stack.pop(value))
+                    {
+                        // closed first, then one more pop: drained for sure
+                        if (stack.closed() && !stack.pop(value))
+                            break;
+                        CPU_RELAX();
+                        continue;
+                    }
+                    ++count;
+                }
+                popped.fetch_add(count, std::memory_order_relaxed);
+
+                double cpu = thread_cpu_ms();
+                double total = consumer_cpu_ms.load(std::memory_order_relaxed);
+                while (!consumer_cpu_ms.compare_exchange_weak(total, total + cpu, std::memory_order_relaxed))
+                {
+                }
+            });
+        }
+
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            producers.emplace_back([i, &stack]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                for (int j = 0; j < WORKLOAD; ++j)
+                {
+                    stack.push(j);
+                    if (j % BURST == BURST - 1)
+                        this_thread::sleep_for(IDLE_GAP);
+                }
+            });
+        }
+
+        for (auto& t : producers)
+            t.join();
+
+        auto closed_at = steady_clock::now();
+        stack.close();
+        for (auto& t : consumers)
+            t.join();
+        shutdown = steady_clock::now() - closed_at;
+    });
+
+    cout << name << " consumer CPU time: " << consumer_cpu_ms.load() << " ms\n";
+    cout << name << " shutdown (close -> consumers exited): "
+         << duration_cast<microseconds>(shutdown).count() << " us, popped "
+         << popped.load() << (popped.load() == NUM_PRODUCERS * WORKLOAD ? " (ok)\n" : " (MISMATCH)\n");
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Lagging consumers vs a bounded stack: producers push flat out, consumers do
+// some work per element. Reports what the overflow policy did with the excess
+// and the largest size producers observed (must stay <= capacity).
+// --------------------------------------------
+template <typename Stack>
+void run_bounded_test(const string& name)
+{
+    static constexpr int CONSUMER_WORK = 200; // CPU_RELAX() per popped element
+
+    Stack stack;
+
+    std::atomic<int> accepted{0};
+    std::atomic<int> popped{0};
+    std::atomic<size_t> peak{0};
+
+    measure(name + " (lagging consumers)", [&]()
+    {
+        vector<thread> consumers;
+        vector<thread> producers;
+        consumers.reserve(NUM_CONSUMERS);
+        producers.reserve(NUM_PRODUCERS);
+
+        for (int i = 0; i < NUM_CONSUMERS; ++i)
+        {
+            consumers.emplace_back([i, &stack, &popped]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+
+                int value;
+                int count = 0;
+                while (stack.pop_wait(value))
+                {
+                    ++count;
+                    for (int k = 0; k < CONSUMER_WORK; ++k)
+                        CPU_RELAX();
+                }
+                popped.fetch_add(count, std::memory_order_relaxed);
+            });
+        }
+
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            producers.emplace_back([i, &stack, &accepted, &peak]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                int count = 0;
+                size_t seen = 0;
+                for (int j = 0; j < WORKLOAD; ++j)
+                {
+                    if (stack.push(j))
+                        ++count;
+                    seen = std::max(seen, stack.size());
+                }
+                accepted.fetch_add(count, std::memory_order_relaxed);
+
+                size_t prev = peak.load(std::memory_order_relaxed);
+                while (prev < seen && !peak.compare_exchange_weak(prev, seen, std::memory_order_relaxed))
+                {
+                }
+            });
+        }
+
+        for (auto& t : producers)
+            t.join();
+        stack.close();
+        for (auto& t : consumers)
+            t.join();
+    });
+
+    int offered = NUM_PRODUCERS * WORKLOAD;
+    int lost = static_cast<int>(stack.dropped());
+    cout << name << " accepted " << accepted.load() << "/" << offered
+         << ", rejected " << offered - accepted.load()
+         << ", dropped " << lost
+         << ", popped " << popped.load()
+         << (popped.load() == accepted.load() - lost ? " (ok)" : " (MISMATCH)") << "\n";
+    cout << name << " peak size " << peak.load() << " / capacity " << stack.capacity()
+         << (peak.load() <= stack.capacity() ? " (ok)\n" : " (OVERFLOW)\n");
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Move-only payloads through a bounded stack: producers push unique_ptr<int>
+// (Block parks them when full), consumers pop_wait() and sum the values.
+// A push(T&&) that fails must hand the value back (checked on a full Reject stack).
+// --------------------------------------------
+template <OverflowPolicy Policy>
+void run_bounded_move_only_test(const string& name)
+{
+    {
+        BoundedStack<std::unique_ptr<int>, OverflowPolicy::Reject> full(1);
+        full.push(std::make_unique<int>(1));
+        std::unique_ptr<int> value = std::make_unique<int>(2);
+        bool pushed = full.push(std::move(value));
+        cout << "Bounded Stack, reject: a failed push(T&&) keeps its value"
+             << (!pushed && value && *value == 2 ? " (ok)\n" : " (MISMATCH)\n");
+    }
+
+    BoundedStack<std::unique_ptr<int>, Policy> stack;
+    std::atomic<long long> sum{0};
+
+    measure(name + " (unique_ptr)", [&]()
+    {
+        vector<thread> consumers;
+        vector<thread> producers;
+
+        for (int i = 0; i < NUM_CONSUMERS; ++i)
+        {
+            consumers.emplace_back([i, &stack, &sum]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+
+                std::unique_ptr<int> value;
+                long long local = 0;
+                while (stack.pop_wait(value))
+                    local += *value;
+                sum.fetch_add(local, std::memory_order_relaxed);
+            });
+        }
+
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            producers.emplace_back([i, &stack]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+                for (int j = 0; j < WORKLOAD; ++j)
+                    stack.push(std::make_unique<int>(j));
+            });
+        }
+
+        for (auto& t : producers)
+            t.join();
+        stack.close();
+        for (auto& t : consumers)
+            t.join();
+    });
+
+    long long expected = static_cast<long long>(NUM_PRODUCERS) * WORKLOAD * (WORKLOAD - 1) / 2;
+    cout << name << " unique_ptr sum " << sum.load() << (sum.load() == expected ? " (ok)\n" : " (MISMATCH)\n");
+    cout << name << " completed\n\n";
+}
+
+#if defined(__linux__)
+// --------------------------------------------
+// epoll consumer: one thread multiplexes the stack's eventfd (it could add
+// sockets to the same epoll set). Producers push in bursts, then close().
+// Reports how many epoll wake-ups the bursts cost (coalesced eventfd writes).
+// --------------------------------------------
+template <typename Stack>
+void run_eventfd_test(const string& name)
+{
+    static constexpr int BURST = 100;
+    static constexpr auto IDLE_GAP = microseconds(200);
+
+    Stack stack;
+    int fd = stack.enable_eventfd();
+    if (fd < 0)
+        return;
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+
+    int popped = 0;
+    int wakeups = 0;
+
+    measure(name + " (epoll phase)", [&]()
+    {
+        thread loop([&]()
+        {
+            pinThreadToCore(0, NUMA_NODE_1);
+
+            epoll_event ready[8];
+            int value;
+            while (true)
+            {
+                int n = epoll_wait(ep, ready, 8, -1);
+                for (int i = 0; i < n; ++i)
+                {
+                    if (ready[i].data.fd != fd)
+                        continue; // a socket would be handled here
+
+                    ++wakeups;
+                    bool closed = stack.closed(); // before the drain, see StackWaiter
+                    stack.ack_event();
+                    while (stack.pop(value))
+                        ++popped;
+                    if (closed)
+                        return;
+                }
+            }
+        });
+
+        vector<thread> producers;
+        producers.reserve(NUM_PRODUCERS);
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            producers.emplace_back([i, &stack]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                for (int j = 0; j < WORKLOAD; ++j)
+                {
+                    stack.push(j);
+                    if (j % BURST == BURST - 1)
+                        this_thread::sleep_for(IDLE_GAP);
+                }
+            });
+        }
+
+        for (auto& t : producers)
+            t.join();
+        stack.close();
+        loop.join();
+    });
+
+    ::close(ep);
+    cout << name << " epoll wake-ups: " << wakeups << " for " << popped << " elements"
+         << (popped == NUM_PRODUCERS * WORKLOAD ? " (ok)\n" : " (MISMATCH)\n");
+    cout << name << " completed\n\n";
+}
+#endif
+
+#if defined(__cpp_impl_coroutine)
+// --------------------------------------------
+// Coroutine consumers: many consumers share ONE executor thread instead of
+// a thread each. Producers push in bursts, then close() ends the consumers.
+// --------------------------------------------
+DetachedTask async_consumer(AsyncStack<int>& stack, SimpleExecutor& executor,
+                            std::atomic<int>& popped, std::atomic<int>& running)
+{
+    co_await executor.schedule(); // continue on the executor thread
+
+    int count = 0;
+    while (auto value = co_await stack.pop_async(executor))
+        ++count;
+
+    popped.fetch_add(count, std::memory_order_relaxed);
+    if (running.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        executor.stop(); // last consumer out
+}
+
+void run_async_test(const string& name, int coroutines)
+{
+    static constexpr int BURST = 100;
+    static constexpr auto IDLE_GAP = microseconds(200);
+
+    AsyncStack<int> stack;
+    SimpleExecutor executor;
+    std::atomic<int> popped{0};
+    std::atomic<int> running{coroutines};
+
+    measure(name + " (async phase)", [&]()
+    {
+        for (int i = 0; i < coroutines; ++i)
+            async_consumer(stack, executor, popped, running);
+
+        thread executor_thread([&]()
+        {
+            pinThreadToCore(0, NUMA_NODE_1);
+            executor.run();
+        });
+
+        vector<thread> producers;
+        producers.reserve(NUM_PRODUCERS);
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            producers.emplace_back([i, &stack]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                for (int j = 0; j < WORKLOAD; ++j)
+                {
+                    stack.push(j);
+                    if (j % BURST == BURST - 1)
+                        this_thread::sleep_for(IDLE_GAP);
+                }
+            });
+        }
+
+        for (auto& t : producers)
+            t.join();
+        stack.close();
+        executor_thread.join();
+    });
+
+    cout << name << " popped " << popped.load()
+         << (popped.load() == NUM_PRODUCERS * WORKLOAD ? " (ok)" : " (MISMATCH)")
+         << ", handed off directly: " << stack.handoffs() << "\n";
+    cout << name << " completed\n\n";
+}
+#endif
+
+// --------------------------------------------
+// Latency percentiles (ns), sorts in place
+// --------------------------------------------
+static void print_percentiles(const string& label, vector<int64_t>& samples)
+{
+    if (samples.empty())
+        return;
+
+    std::sort(samples.begin(), samples.end());
+    cout << label << ":"
+         << " p50 " << samples[samples.size() / 2]
+         << " | p90 " << samples[samples.size() * 90 / 100]
+         << " | p99 " << samples[samples.size() * 99 / 100]
+         << " | max " << samples.back() << " ns\n";
+}
+
+// --------------------------------------------
+// Wake-up latency of try_pop_for(): one producer pushes its steady_clock
+// timestamp every GAP, one consumer waits with a timeout and measures
+// push -> return. Then: how late a wait on an empty stack times out.
+// Stack must hold int64_t.
+// --------------------------------------------
+template <typename Stack>
+void run_wakeup_latency_test(const string& name, int samples = 2000)
+{
+    static constexpr auto GAP = microseconds(100);
+    static constexpr auto TIMEOUT = milliseconds(10);
+    static constexpr auto SHORT_TIMEOUT = microseconds(100);
+
+    auto now_ns = []() { return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count(); };
+
+    Stack stack;
+    vector<int64_t> wakeups;
+    wakeups.reserve(samples);
+    int timeouts = 0;
+
+    thread consumer([&]()
+    {
+        pinThreadToCore(0, NUMA_NODE_1);
+
+        int64_t stamp;
+        for (int k = 0; k < samples; ++k)
+        {
+            if (stack.try_pop_for(stamp, TIMEOUT) == PopResult::Popped)
+                wakeups.push_back(now_ns() - stamp);
+            else
+                ++timeouts;
+        }
+    });
+
+    thread producer([&]()
+    {
+        pinThreadToCore(0, NUMA_NODE_0);
+
+        for (int k = 0; k < samples; ++k)
+        {
+            this_thread::sleep_for(GAP);
+            stack.push(now_ns());
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    print_percentiles(name + " wake-up latency", wakeups);
+    cout << name << " timeouts while producer active: " << timeouts << "\n";
+
+    // Empty stack: every wait must time out, measure the overshoot
+    Stack empty_stack;
+    vector<int64_t> overshoot;
+    int64_t value;
+    for (int k = 0; k < samples / 10; ++k)
+    {
+        int64_t start = now_ns();
+        if (empty_stack.try_pop_for(value, SHORT_TIMEOUT) == PopResult::TimedOut)
+            overshoot.push_back(now_ns() - start - duration_cast<nanoseconds>(SHORT_TIMEOUT).count());
+    }
+    print_percentiles(name + " timeout overshoot", overshoot);
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Priority levels: producers spread their pushes over all levels, then
+// consumers drain. With no concurrent pushes every consumer must see
+// non-increasing levels; any increase is a priority inversion.
+// --------------------------------------------
+template <typename Stack>
+void run_priority_test(const string& name)
+{
+    static constexpr size_t LEVELS = Stack::levels_count();
+
+    Stack stack;
+    std::atomic<int> popped{0};
+    std::atomic<int> inversions{0};
+
+    measure(name + " (push phase)", [&]()
+    {
+        vector<thread> producers;
+        producers.reserve(NUM_PRODUCERS);
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            producers.emplace_back([i, &stack]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                for (int j = 0; j < WORKLOAD; ++j)
+                    stack.push(j, static_cast<size_t>(j) % LEVELS);
+            });
+        }
+        for (auto& t : producers)
+            t.join();
+    });
+
+    measure(name + " (pop phase)", [&]()
+    {
+        vector<thread> consumers;
+        consumers.reserve(NUM_CONSUMERS);
+        for (int i = 0; i < NUM_CONSUMERS; ++i)
+        {
+            consumers.emplace_back([i, &stack, &popped, &inversions]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+
+                int value;
+                size_t level;
+                size_t last = LEVELS;
+                int count = 0;
+                int bad = 0;
+                while (stack.pop(value, level))
+                {
+                    if (level > last)
+                        ++bad;
+                    last = level;
+                    ++count;
+                }
+                popped.fetch_add(count, std::memory_order_relaxed);
+                inversions.fetch_add(bad, std::memory_order_relaxed);
+            });
+        }
+        for (auto& t : consumers)
+            t.join();
+    });
+
+    cout << name << " popped " << popped.load()
+         << (popped.load() == NUM_PRODUCERS * WORKLOAD ? " (ok)" : " (MISMATCH)")
+         << ", priority inversions: " << inversions.load() << "\n";
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Free-list recycling: every thread repeatedly takes HELD objects, touches
+// them and gives them back. acquire() returns a pointer or a Handle;
+// release() takes it back (for a Handle, letting it go is the release).
+// --------------------------------------------
+struct Order
+{
+    int64_t id = 0;
+    int64_t price = 0;
+    int32_t quantity = 0;
+    char side = 'B';
+};
+
+template <typename Acquire, typename Release>
+void run_recycle_test(const string& name, Acquire&& acquire, Release&& release)
+{
+    static constexpr int HELD = 8;
+
+    std::atomic<int> misses{0};
+
+    measure(name + " (acquire/release)", [&]()
+    {
+        vector<thread> threads;
+        threads.reserve(NUM_PRODUCERS);
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            threads.emplace_back([i, &acquire, &release, &misses]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                int missed = 0;
+                for (int j = 0; j < WORKLOAD; ++j)
+                {
+                    decltype(acquire()) held[HELD];
+                    for (int k = 0; k < HELD; ++k)
+                    {
+                        held[k] = acquire();
+                        if (!held[k])
+                        {
+                            ++missed;
+                            continue;
+                        }
+                        held[k]->quantity = j;
+                    }
+                    for (int k = 0; k < HELD; ++k)
+                    {
+                        if (held[k])
+                            release(std::move(held[k]));
+                    }
+                }
+                misses.fetch_add(missed, std::memory_order_relaxed);
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+    });
+
+    cout << name << " pool misses: " << misses.load() << "\n";
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Variable-length messages: every thread keeps a window of IN_FLIGHT buffers,
+// replacing the oldest with a new message of a random size (mostly small,
+// like a market data feed). allocate() may return nullptr (pool exhausted).
+// --------------------------------------------
+template <typename Allocate, typename Deallocate>
+void run_message_buffer_test(const string& name, Allocate&& allocate, Deallocate&& deallocate)
+{
+    static constexpr int IN_FLIGHT = 16;
+    static constexpr int MESSAGES = WORKLOAD * 10;
+
+    std::atomic<int> failures{0};
+
+    measure(name + " (messages)", [&]()
+    {
+        vector<thread> threads;
+        threads.reserve(NUM_PRODUCERS);
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            threads.emplace_back([i, &allocate, &deallocate, &failures]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                std::mt19937 gen(1234 + i);
+                std::uniform_int_distribution<int> pick(0, 99);
+
+                void* window[IN_FLIGHT] = {};
+                int failed = 0;
+                for (int j = 0; j < MESSAGES; ++j)
+                {
+                    // 70% up to 256 B, 25% up to 1 KB, 5% up to 4 KB
+                    int p = pick(gen);
+                    size_t bytes = (p < 70) ? 32 + static_cast<size_t>(p) * 3
+                                 : (p < 95) ? 257 + static_cast<size_t>(p - 70) * 30
+                                            : 1025 + static_cast<size_t>(p - 95) * 600;
+
+                    void*& slot = window[j % IN_FLIGHT];
+                    if (slot)
+                        deallocate(slot);
+                    slot = allocate(bytes);
+                    if (slot)
+                        std::memset(slot, j, 32); // header write
+                    else
+                        ++failed;
+                }
+                for (void* buffer : window)
+                {
+                    if (buffer)
+                        deallocate(buffer);
+                }
+                failures.fetch_add(failed, std::memory_order_relaxed);
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+    });
+
+    cout << name << " allocation failures: " << failures.load() << "\n";
+}
+
+// --------------------------------------------
+// BufferPool under concurrent allocate/free of random sizes. Every buffer is
+// filled with its owner's tag and checked before it is freed, so a buffer
+// handed out twice shows up as corruption. The counters must add up:
+// hits + misses == allocate() calls, failed == nullptrs returned.
+// --------------------------------------------
+void run_buffer_pool_stress_test(const string& name)
+{
+    static constexpr int IN_FLIGHT = 16;
+    static constexpr int ROUNDS = WORKLOAD * 10;
+
+    // Fewer buffers per class than the threads keep in flight: fallback and failures happen
+    BufferPool pool(static_cast<uint32_t>(NUM_PRODUCERS * IN_FLIGHT * 3 / 4));
+    std::atomic<long long> calls{0};
+    std::atomic<long long> nulls{0};
+    std::atomic<long long> corrupt{0};
+
+    measure(name + " (stress)", [&]()
+    {
+        vector<thread> threads;
+        threads.reserve(NUM_PRODUCERS);
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            threads.emplace_back([i, &pool, &calls, &nulls, &corrupt]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+
+                std::mt19937 gen(4321 + i);
+                std::uniform_int_distribution<size_t> size_class(0, BufferPool::CLASSES - 1);
+                const unsigned char tag = static_cast<unsigned char>(i + 1);
+
+                auto release = [&pool, &corrupt, tag](void* buffer)
+                {
+                    unsigned char* bytes = static_cast<unsigned char*>(buffer);
+                    size_t n = pool.buffer_size(buffer);
+                    for (size_t k = 0; k < n; ++k)
+                    {
+                        if (bytes[k] != tag)
+                        {
+                            corrupt.fetch_add(1, std::memory_order_relaxed);
+                            break;
+                        }
+                    }
+                    pool.deallocate(buffer);
+                };
+
+                void* window[IN_FLIGHT] = {};
+                long long failed = 0;
+                for (int j = 0; j < ROUNDS; ++j)
+                {
+                    void*& slot = window[j % IN_FLIGHT];
+                    if (slot)
+                        release(slot);
+
+                    size_t bytes = 1 + gen() % BufferPool::class_size(size_class(gen)); // every class equally often
+                    slot = pool.allocate(bytes);
+                    if (!slot)
+                    {
+                        ++failed;
+                        continue;
+                    }
+                    if (pool.buffer_size(slot) < bytes)
+                        corrupt.fetch_add(1, std::memory_order_relaxed);
+                    std::memset(slot, tag, pool.buffer_size(slot));
+                }
+                for (void* buffer : window)
+                {
+                    if (buffer)
+                        release(buffer);
+                }
+                calls.fetch_add(ROUNDS, std::memory_order_relaxed);
+                nulls.fetch_add(failed, std::memory_order_relaxed);
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+    });
+
+    long long hits = 0, misses = 0, failed = 0;
+    for (size_t c = 0; c < BufferPool::CLASSES; ++c)
+    {
+        BufferPool::ClassStats st = pool.stats(c);
+        hits += static_cast<long long>(st.hits);
+        misses += static_cast<long long>(st.misses);
+        failed += static_cast<long long>(st.failed);
+    }
+    bool ok = hits + misses == calls.load() && failed == nulls.load() && corrupt.load() == 0;
+
+    cout << name << " allocate() " << calls.load() << " | hits + misses " << hits + misses
+         << " | failed " << failed << " / nullptr " << nulls.load()
+         << " | corrupt " << corrupt.load() << (ok ? " (ok)\n" : " (MISMATCH)\n");
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Producer-side latency: every push of NUM_PRODUCERS concurrent producers is
+// timed on its own. The tail shows what CAS retries under contention cost.
+// --------------------------------------------
+template <typename Stack>
+void run_push_latency_test(const string& name)
 {
     Stack stack;
+    vector<vector<int64_t>> per_thread(NUM_PRODUCERS);
+    vector<thread> producers;
+    producers.reserve(NUM_PRODUCERS);
+
+    for (int i = 0; i < NUM_PRODUCERS; ++i)
+    {
+        producers.emplace_back([i, &stack, &per_thread]()
+        {
+            pinThreadToCore(i, NUMA_NODE_0);
+
+            vector<int64_t>& samples = per_thread[i];
+            samples.reserve(WORKLOAD);
+            for (int j = 0; j < WORKLOAD; ++j)
+            {
+                auto start = steady_clock::now();
+                stack.push(j);
+                samples.push_back(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+            }
+        });
+    }
+
+    for (auto& t : producers)
+        t.join();
+
+    vector<int64_t> all;
+    for (auto& samples : per_thread)
+        all.insert(all.end(), samples.begin(), samples.end());
+    print_percentiles(name + " push latency", all);
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Payload cost: a 200-byte order message
+//   copy     : push(const&) copies it into the node, pop(out) copies it out
+//   in place : emplace() builds it inside the node, pop_into() reads it there
+//   pop_handle : emplace(), then the popped node itself is read through a handle
+//   unique_ptr : move-only payload, push(T&&) + try_pop()
+// --------------------------------------------
+struct OrderMessage
+{
+    int64_t id = 0;
+    int64_t price = 0;
+    int32_t quantity = 0;
+    char side = 'B';
+    char text[179] = {}; // free-text tag, pads the message to 200 bytes
+
+    OrderMessage() = default;
+    OrderMessage(int64_t i, int64_t p, int32_t q, char s) : id(i), price(p), quantity(q), side(s) {}
+};
+
+template <template <typename> class Stack>
+void run_payload_test(const string& name)
+{
+    // producers push WORKLOAD messages each, then consumers drain; returns the price sum
+    auto run_phases = [](const string& label, auto& stack, auto&& produce, auto&& consume)
+    {
+        std::atomic<long long> sum{0};
+        vector<thread> threads;
+
+        measure(label + " (push phase)", [&]()
+        {
+            for (int i = 0; i < NUM_PRODUCERS; ++i)
+                threads.emplace_back([i, &stack, &produce]()
+                {
+                    pinThreadToCore(i, NUMA_NODE_0);
+                    for (int j = 0; j < WORKLOAD; ++j)
+                        produce(stack, j);
+                });
+            for (auto& t : threads)
+                t.join();
+        });
+        threads.clear();
+
+        measure(label + " (pop phase)", [&]()
+        {
+            for (int i = 0; i < NUM_CONSUMERS; ++i)
+                threads.emplace_back([i, &stack, &consume, &sum]()
+                {
+                    pinThreadToCore(i, NUMA_NODE_1);
+                    long long local = 0;
+                    while (consume(stack, local))
+                    {
+                    }
+                    sum.fetch_add(local, std::memory_order_relaxed);
+                });
+            for (auto& t : threads)
+                t.join();
+        });
+        return sum.load();
+    };
+
+    long long expected = static_cast<long long>(NUM_PRODUCERS) * WORKLOAD * (WORKLOAD - 1) / 2;
+    auto check = [&](const string& label, long long sum)
+    {
+        cout << label << " price sum " << sum << (sum == expected ? " (ok)\n" : " (MISMATCH)\n");
+    };
+
+    {
+        Stack<OrderMessage> stack;
+        string label = name + ", copy";
+        check(label, run_phases(label, stack,
+            [](auto& s, int j) { OrderMessage msg(j, j, 100, 'B'); s.push(msg); },
+            [](auto& s, long long& sum)
+            {
+                OrderMessage msg;
+                if (!s.pop(msg))
+                    return false;
+                sum += msg.price;
+                return true;
+            }));
+    }
+    {
+        Stack<OrderMessage> stack;
+        string label = name + ", in place";
+        check(label, run_phases(label, stack,
+            [](auto& s, int j) { s.emplace(j, j, 100, 'B'); },
+            [](auto& s, long long& sum)
+            {
+                return s.pop_into([&sum](OrderMessage& msg) { sum += msg.price; });
+            }));
+    }
+    {
+        Stack<OrderMessage> stack;
+        string label = name + ", pop_handle";
+        check(label, run_phases(label, stack,
+            [](auto& s, int j) { s.emplace(j, j, 100, 'B'); },
+            [](auto& s, long long& sum)
+            {
+                auto msg = s.pop_handle(); // retired when msg goes out of scope
+                if (!msg)
+                    return false;
+                sum += msg->price;
+                return true;
+            }));
+    }
+    {
+        Stack<std::unique_ptr<OrderMessage>> stack;
+        string label = name + ", unique_ptr";
+        check(label, run_phases(label, stack,
+            [](auto& s, int j) { s.push(std::make_unique<OrderMessage>(j, j, 100, 'B')); },
+            [](auto& s, long long& sum)
+            {
+                std::optional<std::unique_ptr<OrderMessage>> msg = s.try_pop();
+                if (!msg)
+                    return false;
+                sum += (*msg)->price;
+                return true;
+            }));
+    }
+    cout << name << " completed\n\n";
+}
 
+// --------------------------------------------
+// Trivially copyable 200-byte payload copied in and out (push / pop).
+// SegmentedStack keeps it in raw slot bytes: a new segment constructs no
+// OrderMessage (no 64 x 200 bytes of default member initializers).
+// --------------------------------------------
+static_assert(std::is_trivially_copyable_v<OrderMessage>);
+
+template <typename Stack>
+void run_copy_payload_test(const string& name)
+{
+    Stack stack;
+    std::atomic<long long> sum{0};
     vector<thread> threads;
-    threads.reserve(NUM_PRODUCERS + NUM_CONSUMERS);
 
-    // -----------------------------
-    // PRODUCERS
-    // -----------------------------
     measure(name + " (push phase)", [&]()
     {
         for (int i = 0; i < NUM_PRODUCERS; ++i)
-        {
             threads.emplace_back([i, &stack]()
+            {
+                pinThreadToCore(i, NUMA_NODE_0);
+                for (int j = 0; j < WORKLOAD; ++j)
+                    stack.push(OrderMessage(j, j, 100, 'B'));
+            });
+        for (auto& t : threads)
+            t.join();
+    });
+    threads.clear();
+
+    measure(name + " (pop phase)", [&]()
+    {
+        for (int i = 0; i < NUM_CONSUMERS; ++i)
+            threads.emplace_back([i, &stack, &sum]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+                long long local = 0;
+                OrderMessage msg;
+                while (stack.pop(msg))
+                    local += msg.price;
+                sum.fetch_add(local, std::memory_order_relaxed);
+            });
+        for (auto& t : threads)
+            t.join();
+    });
+
+    long long expected = static_cast<long long>(NUM_PRODUCERS) * WORKLOAD * (WORKLOAD - 1) / 2;
+    cout << name << " price sum " << sum.load() << (sum.load() == expected ? " (ok)\n" : " (MISMATCH)\n");
+    cout << name << " completed\n\n";
+}
+
+// --------------------------------------------
+// Fixed thread layout: 'producers' threads push WORKLOAD values each WHILE
+// 'consumers' threads drain, until everything pushed has been taken.
+// Same layout for a cardinality-specialized stack and the MPMC one it replaces.
+// consume(stack, record) takes what it can, calls record(value) for every
+// element and returns how many.
+// Every pushed value is unique (producer * WORKLOAD + j) and counted when it
+// comes out, so a lost or duplicated element is reported, not just timed.
+// A lost one would keep the consumers spinning: they give up once nothing
+// came out for DRAIN_TIMEOUT after the producers finished.
+// --------------------------------------------
+template <typename Stack, typename Consume>
+void run_cardinality_test(const string& name, int producers, int consumers, Consume&& consume)
+{
+    static constexpr std::chrono::seconds DRAIN_TIMEOUT{2};
+
+    Stack stack;
+    const long long total = static_cast<long long>(producers) * WORKLOAD;
+    std::atomic<long long> taken{0};
+    std::atomic<int> producers_left{producers};
+    vector<std::atomic<int>> seen(static_cast<size_t>(total));
+
+    vector<thread> threads;
+    threads.reserve(producers + consumers);
+
+    measure(name + " (" + to_string(producers) + "P/" + to_string(consumers) + "C)", [&]()
+    {
+        for (int i = 0; i < producers; ++i)
+        {
+            threads.emplace_back([i, &stack, &producers_left]()
             {
                 pinThreadToCore(i, NUMA_NODE_0);
 
                 for (int j = 0; j < WORKLOAD; ++j)
+                    stack.push(i * WORKLOAD + j);
+                producers_left.fetch_sub(1, std::memory_order_release);
+            });
+        }
+
+        for (int i = 0; i < consumers; ++i)
+        {
+            threads.emplace_back([i, &stack, &taken, &producers_left, &seen, &consume, total]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
+
+                auto record = [&seen, total](int value)
                 {
-                    stack.push(j);
+                    if (value >= 0 && value < total)
+                        seen[static_cast<size_t>(value)].fetch_add(1, std::memory_order_relaxed);
+                };
+
+                auto last_progress = std::chrono::steady_clock::now();
+                while (taken.load(std::memory_order_relaxed) < total)
+                {
+                    size_t n = consume(stack, record);
+                    if (n > 0)
+                    {
+                        taken.fetch_add(static_cast<long long>(n), std::memory_order_relaxed);
+                        last_progress = std::chrono::steady_clock::now();
+                        continue;
+                    }
+
+                    CPU_RELAX();
+                    if (producers_left.load(std::memory_order_acquire) != 0)
+                        last_progress = std::chrono::steady_clock::now();
+                    else if (std::chrono::steady_clock::now() - last_progress > DRAIN_TIMEOUT)
+                        break; // everything pushed, nothing comes out: lost elements
                 }
             });
         }
 
         for (auto& t : threads)
             t.join();
+    });
 
-        threads.clear();
+    long long lost = 0, duplicated = 0;
+    for (auto& count : seen)
+    {
+        int c = count.load(std::memory_order_relaxed);
+        lost += (c == 0);
+        duplicated += (c > 1) ? c - 1 : 0;
+    }
+    bool drained_empty = stack.empty();
+    bool ok = lost == 0 && duplicated == 0 && drained_empty;
+
+    cout << name << " taken " << taken.load() << " of " << total
+         << " | lost " << lost << " | duplicated " << duplicated
+         << " | empty after drain " << (drained_empty ? "yes" : "no")
+         << (ok ? " (ok)\n" : " (MISMATCH)\n");
+    cout << name << " completed\n\n";
+}
+
+template <typename Stack>
+void run_cardinality_test(const string& name, int producers, int consumers)
+{
+    run_cardinality_test<Stack>(name, producers, consumers, [](Stack& stack, auto& record) -> size_t
+    {
+        int value;
+        if (!stack.pop(value))
+            return 0;
+        record(value);
+        return 1;
     });
+}
 
-    // -----------------------------
-    // CONSUMERS
-    // -----------------------------
-    measure(name + " (pop phase)", [&]()
+template <typename Stack>
+void run_cardinality_pop_all_test(const string& name, int producers)
+{
+    run_cardinality_test<Stack>(name, producers, 1, [](Stack& stack, auto& record) -> size_t
     {
-        for (int i = 0; i < NUM_CONSUMERS; ++i)
+        auto all = stack.pop_all();
+        size_t n = 0;
+        for (int value : all)
         {
-            threads.emplace_back([i, &stack]()
+            record(value);
+            ++n;
+        }
+        return n;
+    });
+}
+
+// --------------------------------------------
+// LockFreeBag ownership under stealing: producers push unique values and pop
+// every other step (mostly their own chunks), STEALERS own no chunks and only
+// take from the others. Every value must come out exactly once and the bag
+// must be empty after the drain.
+// --------------------------------------------
+template <typename Bag>
+void run_bag_steal_test(const string& name)
+{
+    static constexpr int STEALERS = 2;
+
+    Bag bag;
+    const int total = NUM_PRODUCERS * WORKLOAD;
+    vector<std::atomic<int>> seen(static_cast<size_t>(total));
+    std::atomic<int> producers_left{NUM_PRODUCERS};
+
+    auto record = [&seen, total](int value)
+    {
+        if (value >= 0 && value < total)
+            seen[static_cast<size_t>(value)].fetch_add(1, std::memory_order_relaxed);
+    };
+
+    measure(name + " (steal)", [&]()
+    {
+        vector<thread> threads;
+        threads.reserve(NUM_PRODUCERS + STEALERS);
+        for (int i = 0; i < NUM_PRODUCERS; ++i)
+        {
+            threads.emplace_back([i, &bag, &record, &producers_left]()
             {
-                pinThreadToCore(i, NUMA_NODE_1);
+                pinThreadToCore(i, NUMA_NODE_0);
 
                 int value;
+                for (int j = 0; j < WORKLOAD; ++j)
+                {
+                    bag.push(i * WORKLOAD + j);
+                    if (j % 2 == 1 && bag.pop(value))
+                        record(value);
+                }
+                producers_left.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        for (int i = 0; i < STEALERS; ++i)
+        {
+            threads.emplace_back([i, &bag, &record, &producers_left]()
+            {
+                pinThreadToCore(i, NUMA_NODE_1);
 
+                int value;
                 while (true)
                 {
-                    if (!stack.pop(value))
+                    if (bag.pop(value))
+                        record(value);
+                    else if (producers_left.load(std::memory_order_acquire) == 0)
                         break;
+                    else
+                        CPU_RELAX();
                 }
             });
         }
-
         for (auto& t : threads)
             t.join();
     });
 
+    // Whatever the stealers missed at the end (a chunk they scanned before its last push)
+    int value;
+    while (bag.pop(value))
+        record(value);
+
+    long long lost = 0, duplicated = 0;
+    for (auto& count : seen)
+    {
+        int c = count.load(std::memory_order_relaxed);
+        lost += (c == 0);
+        duplicated += (c > 1) ? c - 1 : 0;
+    }
+    bool drained_empty = bag.empty();
+    bool ok = lost == 0 && duplicated == 0 && drained_empty;
+
+    cout << name << " lost " << lost << " | duplicated " << duplicated
+         << " | empty after drain " << (drained_empty ? "yes" : "no")
+         << (ok ? " (ok)\n" : " (MISMATCH)\n");
     cout << name << " completed\n\n";
 }
 
+// --------------------------------------------
+// Relaxation probe: out-of-order distance of pop()
+// distance = number of elements still in the stack that were pushed
+//            after the popped one (always 0 for a strict LIFO)
+// Single-threaded random mix of push/pop, so the stack size wanders.
+// --------------------------------------------
+template <typename Stack>
+void measure_relaxation(const string& name, int operations = NUM_PRODUCERS * WORKLOAD)
+{
+    Stack stack;
+    std::set<int> live; // ids currently in the stack
+    vector<size_t> distances;
+    distances.reserve(operations);
+
+    std::mt19937 gen(42);
+    std::bernoulli_distribution do_push(0.6);
+    int next_id = 0;
+
+    for (int i = 0; i < operations; ++i)
+    {
+        if (live.empty() || do_push(gen))
+        {
+            stack.push(next_id);
+            live.insert(next_id++);
+            continue;
+        }
+
+        int value;
+        if (!stack.pop(value))
+            continue;
+
+        auto it = live.find(value);
+        distances.push_back(std::distance(std::next(it), live.end()));
+        live.erase(it);
+    }
+
+    if (distances.empty())
+        return;
+
+    std::sort(distances.begin(), distances.end());
+    double sum = 0;
+    for (size_t d : distances)
+        sum += d;
+
+    cout << name << " out-of-order distance:"
+         << " mean " << sum / distances.size()
+         << " | p50 " << distances[distances.size() / 2]
+         << " | p99 " << distances[distances.size() * 99 / 100]
+         << " | max " << distances.back() << "\n";
+}
+
 // --------------------------------------------
 // MAIN
 // --------------------------------------------
@@ -145,6 +1740,177 @@ int main()
     run_test<LockFreeTreiberMPMCStackABA<int>>("ABA Fixed Stack");
     run_test<LockFreeTreiberMPMCStackHazardPointer<int>>("Hazard Pointer Stack");
     run_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack");
+    // Same workload without nodes: one preallocated array, no reclamation
+    run_capacity_test<ArrayStack<int>>("Array Stack", NUM_PRODUCERS * WORKLOAD);
+    run_test<LockFreeTreiberMPMCStackAdaptive<int>>("Adaptive Stack");
+
+    // Threshold sweep for tuning the adaptive switch (per-mille of failed head CASes).
+    // Mixed push/pop burst with a short window: the switch, the hysteresis and
+    // the elimination path actually run (run_test() above never switches)
+    run_adaptive_contention_test("Adaptive Stack, burst (enter 50%, exit 10%)", 256,
+        [](auto& stack) { stack.set_thresholds(500, 100); });
+    run_adaptive_contention_test("Adaptive Stack, burst (enter 10%, exit 2%)", 256,
+        [](auto& stack) { stack.set_thresholds(100, 20); });
+    run_adaptive_contention_test("Adaptive Stack, burst (enter 2%, exit 0.5%)", 256,
+        [](auto& stack) { stack.set_thresholds(20, 5); });
+
+    // Shard count vs throughput
+    run_test<ShardedStack<int, 1>>("Sharded EBR Stack (1 shard)");
+    run_test<ShardedStack<int, 2>>("Sharded EBR Stack (2 shards)");
+    run_test<ShardedStack<int, 4>>("Sharded EBR Stack (4 shards)");
+    run_test<ShardedStack<int, 8>>("Sharded EBR Stack (8 shards)");
+    run_test<ShardedStack<int, 4, LockFreeTreiberMPMCStackHazardPointer<int>>>("Sharded Hazard Pointer Stack (4 shards)");
+
+    // Refill from a shared stack: half at a time vs one element at a time
+    run_steal_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, steal_half", true);
+    run_steal_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, steal by pop", false);
+    run_steal_test<LockFreeTreiberMPMCStackABA<int>>("ABA Fixed Stack, steal_half", true);
+
+    // Write-combined producers: one head CAS per flush instead of per push
+    run_staged_test<LockFreeTreiberMPMCStack<int>>("Base Stack, staged x8", 8);
+    run_staged_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, staged x8", 8);
+    run_staged_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, staged x64", 64);
+
+    // Batch consumers: one head CAS per pop_bulk()
+    run_bulk_pop_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, pop_bulk x8", 8);
+    run_bulk_pop_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, pop_bulk x64", 64);
+    run_bulk_pop_test<LockFreeTreiberMPMCStackHazardPointer<int>>("Hazard Pointer Stack, pop_bulk x8", 8);
+    run_bulk_pop_test<LockFreeTreiberMPMCStackHazardPointer<int>>("Hazard Pointer Stack, pop_bulk x64", 64);
+
+    // Drain-all consumers: one head exchange per pop_all()
+    run_pop_all_test<LockFreeTreiberMPMCStack<int>>("Base Stack, pop_all", false);
+    run_pop_all_test<LockFreeTreiberMPMCStackABA<int>>("ABA Fixed Stack, pop_all", false);
+    run_pop_all_test<LockFreeTreiberMPMCStackHazardPointer<int>>("Hazard Pointer Stack, pop_all", false);
+    run_pop_all_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, pop_all", false);
+    run_pop_all_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, pop_all FIFO", true);
+    run_pop_all_test<LockFreeTreiberMPMCStackAdaptive<int>>("Adaptive Stack, pop_all", false);
+    run_pop_all_test<ShardedStack<int, 4>>("Sharded EBR Stack (4 shards), pop_all", false);
+    run_pop_all_test<ShardedStack<int, 4, LockFreeTreiberMPMCStackHazardPointer<int>>>("Sharded Hazard Pointer Stack (4 shards), pop_all", false);
+    run_pop_all_test<RelaxedStack<int, 4>>("Relaxed Stack (k=4), pop_all", false);
+
+    // Idle consumers: park on a futex vs spin on pop()
+    run_blocking_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, pop_wait", true);
+    run_blocking_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, spinning pop", false);
+    run_blocking_test<LockFreeTreiberMPMCStackHazardPointer<int>>("Hazard Pointer Stack, pop_wait", true);
+    run_blocking_test<LockFreeTreiberMPMCStack<int>>("Base Stack, pop_wait", true);
+    run_blocking_test<LockFreeTreiberMPMCStackABA<int>>("ABA Fixed Stack, pop_wait", true);
+
+    // Backpressure: what happens to the excess when consumers lag
+    run_bounded_test<BoundedStack<int, OverflowPolicy::Reject>>("Bounded Stack, reject");
+    run_bounded_test<BoundedStack<int, OverflowPolicy::Block>>("Bounded Stack, block");
+    run_bounded_test<BoundedStack<int, OverflowPolicy::DropOldest>>("Bounded Stack, drop oldest");
+    run_bounded_move_only_test<OverflowPolicy::Block>("Bounded Stack, block, move-only");
+
+#if defined(__linux__)
+    // Readiness fd for epoll loops: one eventfd write per burst
+    run_eventfd_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack, eventfd");
+    run_eventfd_test<LockFreeTreiberMPMCStackABA<int>>("ABA Fixed Stack, eventfd");
+#endif
+
+#if defined(__cpp_impl_coroutine)
+    // Coroutine consumers on one executor thread, producers hand off directly
+    run_async_test("Async Stack, 16 coroutines", 16);
+#endif
+
+    // Deadline-bounded waits: wake-up latency percentiles and timeout accuracy
+    run_wakeup_latency_test<LockFreeTreiberMPMCStackEBR<int64_t>>("EBR Stack, try_pop_for");
+    run_wakeup_latency_test<LockFreeTreiberMPMCStackHazardPointer<int64_t>>("Hazard Pointer Stack, try_pop_for");
+    run_wakeup_latency_test<LockFreeTreiberMPMCStack<int64_t>>("Base Stack, try_pop_for");
+
+    // Producer-side latency: CAS retry loop vs one fetch_add per push
+    run_test<SegmentedStack<int>>("Segmented Stack (fetch_add push)");
+    run_push_latency_test<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack");
+    run_push_latency_test<SegmentedStack<int>>("Segmented Stack");
+
+    // Per-level heads + summary bitmap: one word tells consumers where to pop
+    run_priority_test<PriorityStack<int, 8>>("Priority Stack (8 levels)");
+    run_priority_test<PriorityStack<int, 64>>("Priority Stack (64 levels)");
+
+    // Object recycling: ad-hoc stack of pointers vs ObjectPool
+    {
+        static constexpr size_t POOL_SIZE = 1024;
+
+        vector<Order> orders(POOL_SIZE);
+        LockFreeTreiberMPMCStackEBR<Order*> free_list;
+        for (auto& order : orders)
+            free_list.push(&order);
+        run_recycle_test("EBR Stack of Order*",
+            [&]() { Order* order = nullptr; free_list.pop(order); return order; },
+            [&](Order* order) { free_list.push(order); });
+
+        ObjectPool<Order, 0> shared_pool(POOL_SIZE);
+        run_recycle_test("Object Pool (no cache)",
+            [&]() { return shared_pool.acquire(); },
+            [&](Order* order) { shared_pool.release(order); });
+
+        ObjectPool<Order> pool(POOL_SIZE);
+        run_recycle_test("Object Pool (per-thread cache)",
+            [&]() { return pool.acquire(); },
+            [&](Order* order) { pool.release(order); });
+        run_recycle_test("Object Pool (per-thread cache, Handle)",
+            [&]() { return pool.acquire_handle(); },
+            [](ObjectPool<Order>::Handle) {});
+    }
+
+    // Variable-length messages: malloc vs size-class free-lists
+    {
+        run_message_buffer_test("malloc/free",
+            [](size_t bytes) { return std::malloc(bytes); },
+            [](void* buffer) { std::free(buffer); });
+        cout << "malloc/free completed\n\n";
+
+        // Big classes smaller than what the threads keep in flight: exercises fallback
+        BufferPool buffers({16, 16, 16, 16, 8, 8, 4, 4});
+        run_message_buffer_test("Buffer Pool",
+            [&](size_t bytes) { return buffers.allocate(bytes); },
+            [&](void* buffer) { buffers.deallocate(buffer); });
+        for (size_t c = 0; c < BufferPool::CLASSES; ++c)
+        {
+            BufferPool::ClassStats st = buffers.stats(c);
+            cout << "Buffer Pool class " << BufferPool::class_size(c) << " B: hits " << st.hits
+                 << " | misses " << st.misses << " | failed " << st.failed << "\n";
+        }
+        cout << "Buffer Pool completed\n\n";
+    }
+    run_buffer_pool_stress_test("Buffer Pool");
+
+    run_test<TimestampedStack<int>>("Timestamped Stack (TS-stack)");
+    run_test<PerCpuStack<int>>(PerCpuStack<int>::uses_rseq() ? "Per-CPU Stack (rseq)" : "Per-CPU Stack (CAS fallback)");
+
+    // No order at all: per-thread chunks, local adds, steal on empty
+    run_test<LockFreeBag<int>>("Lock-free Bag (per-thread chunks)");
+    run_bag_steal_test<LockFreeBag<int>>("Lock-free Bag");
+
+    // 200-byte payload: copy in and out vs constructed and consumed in place
+    run_payload_test<LockFreeTreiberMPMCStackEBR>("EBR Stack");
+    run_payload_test<LockFreeTreiberMPMCStackHazardPointer>("Hazard Pointer Stack");
+
+    // Trivially copyable 200-byte payload: per-push node vs raw segment slots
+    run_copy_payload_test<LockFreeTreiberMPMCStackEBR<OrderMessage>>("EBR Stack, OrderMessage copy");
+    run_copy_payload_test<SegmentedStack<OrderMessage>>("Segmented Stack, OrderMessage copy (raw slots)");
+
+    // Cardinality-specialized stacks vs MPMC, same thread layout each
+    run_cardinality_test<MPMCStack<int>>("MPMC EBR Stack, pop", NUM_PRODUCERS, 1);
+    run_cardinality_test<MPSCStack<int>>("MPSC Stack, pop", NUM_PRODUCERS, 1);
+    run_cardinality_pop_all_test<MPMCStack<int>>("MPMC EBR Stack, pop_all", NUM_PRODUCERS);
+    run_cardinality_pop_all_test<MPSCStack<int>>("MPSC Stack, pop_all", NUM_PRODUCERS);
+    run_cardinality_test<MPMCStack<int>>("MPMC EBR Stack", 1, NUM_CONSUMERS);
+    run_cardinality_test<SPMCStack<int>>("SPMC Stack", 1, NUM_CONSUMERS);
+    run_cardinality_test<MPMCStack<int>>("MPMC EBR Stack", 1, 1);
+    run_cardinality_test<SPSCStack<int>>("SPSC Stack", 1, 1);
+
+    // Number of heads vs throughput and ordering
+    run_test<RelaxedStack<int, 2>>("Relaxed Stack (k=2)");
+    run_test<RelaxedStack<int, 4>>("Relaxed Stack (k=4)");
+    run_test<RelaxedStack<int, 8>>("Relaxed Stack (k=8)");
+
+    measure_relaxation<LockFreeTreiberMPMCStackEBR<int>>("EBR Stack");
+    measure_relaxation<TimestampedStack<int>>("Timestamped Stack (TS-stack)");
+    measure_relaxation<RelaxedStack<int, 2>>("Relaxed Stack (k=2)");
+    measure_relaxation<RelaxedStack<int, 4>>("Relaxed Stack (k=4)");
+    measure_relaxation<RelaxedStack<int, 8>>("Relaxed Stack (k=8)");
+    measure_relaxation<LockFreeBag<int>>("Lock-free Bag");
+    cout << "\n";
 
     return 0;
 }
@@ -0,0 +1,157 @@
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+/*
+    Privately owned chain of stack nodes, returned by pop_all()
+
+    Key idea:
+    - pop_all() takes the whole stack with ONE head.exchange(nullptr)
+      (one CAS loop for the tagged ABA head).
+    - From then on no other thread can reach the chain through head, so the
+      caller walks it with plain relaxed loads: no epoch, no hazard pointer,
+      no CAS per element.
+
+    LIFO : begin() is the last pushed element (same order as repeated pop())
+    FIFO : reverse() relinks the chain in place, O(n), no allocation
+
+Lifetime:
+    - Move-only, must not outlive the stack it came from.
+    - The destructor hands every node to 'Dispose':
+        EBR / HP stacks : retire (concurrent poppers may still read a node
+                          they loaded from head before the exchange)
+        Base / ABA      : nothing, same as their pop() (they never free nodes)
+        single consumer : delete (CardinalityStack MPSC)
+    - Keep the range in a named variable while iterating:
+        auto all = stack.pop_all(true);
+        for (int v : all) { ... }
+*/
+template <typename T, typename Node, typename Dispose>
+class NodeChain
+{
+private:
+    Node* first = nullptr;
+    Dispose dispose;
+
+    void release()
+    {
+        while (first)
+        {
+            Node* next = first->next.load(std::memory_order_relaxed);
+            dispose(first);
+            first = next;
+        }
+    }
+
+public:
+    class iterator
+    {
+    private:
+        Node* node = nullptr;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = T*;
+        using reference         = T&;
+
+        iterator() = default;
+        explicit iterator(Node* n) : node(n) {}
+
+        T& operator*() const { return node->data; }
+        T* operator->() const { return &node->data; }
+
+        iterator& operator++()
+        {
+            node = node->next.load(std::memory_order_relaxed);
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const { return node == other.node; }
+        bool operator!=(const iterator& other) const { return node != other.node; }
+    };
+
+    NodeChain(const NodeChain&) = delete;
+    NodeChain& operator=(const NodeChain&) = delete;
+
+    NodeChain() = default;
+
+    NodeChain(Node* chain, Dispose d) : first(chain), dispose(d) {}
+
+    NodeChain(NodeChain&& other) noexcept
+        : first(std::exchange(other.first, nullptr))
+        , dispose(std::move(other.dispose))
+    {
+    }
+
+    NodeChain& operator=(NodeChain&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            first = std::exchange(other.first, nullptr);
+            dispose = std::move(other.dispose);
+        }
+        return *this;
+    }
+
+    ~NodeChain()
+    {
+        release();
+    }
+
+    iterator begin() const { return iterator(first); }
+    iterator end() const { return iterator(); }
+
+    bool empty() const { return first == nullptr; }
+
+    // O(n) walk
+    size_t size() const
+    {
+        size_t n = 0;
+        for (Node* node = first; node; node = node->next.load(std::memory_order_relaxed))
+            ++n;
+        return n;
+    }
+
+    // LIFO <-> FIFO, relinks in place
+    void reverse()
+    {
+        Node* prev = nullptr;
+        while (first)
+        {
+            Node* next = first->next.load(std::memory_order_relaxed);
+            first->next.store(prev, std::memory_order_relaxed);
+            prev = first;
+            first = next;
+        }
+        first = prev;
+    }
+};
+
+// Dispose policy for stacks that never free popped nodes (Base, ABA)
+struct KeepNodes
+{
+    template <typename Node>
+    void operator()(Node*) const {}
+};
+
+// Dispose policy for chains no other thread can reach any more
+// (single-consumer stacks: nobody else ever dereferences a popped node)
+struct DeleteNodes
+{
+    template <typename Node>
+    void operator()(Node* node) const { delete node; }
+};
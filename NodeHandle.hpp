@@ -0,0 +1,81 @@
+
+#pragma once
+
+#include <utility>
+
+/*
+    Owner of ONE popped stack node, returned by pop_handle()
+
+    Key idea:
+    - pop_handle() unlinks the top node exactly like pop(), but hands over the
+      node itself instead of copying its data out.
+    - Once the CAS succeeded no other thread can reach the node through head,
+      so the payload is read (or modified) in place: no copy, no move, and no
+      epoch or hazard pointer is held while the caller works on it.
+    - The destructor (or reset()) hands the node to 'Dispose', the same
+      policies as NodeChain:
+        EBR / HP stacks : retire (a concurrent pop() may still read the node's
+                          next, it loaded the node before our CAS)
+
+Lifetime:
+    - Move-only, must not outlive the stack it came from.
+    - An empty handle (stack was empty) converts to false.
+        if (auto msg = stack.pop_handle())
+            process(*msg);
+*/
+template <typename T, typename Node, typename Dispose>
+class NodeHandle
+{
+private:
+    Node* node = nullptr;
+    Dispose dispose;
+
+public:
+    NodeHandle(const NodeHandle&) = delete;
+    NodeHandle& operator=(const NodeHandle&) = delete;
+
+    NodeHandle() = default;
+
+    NodeHandle(Node* n, Dispose d) : node(n), dispose(d) {}
+
+    NodeHandle(NodeHandle&& other) noexcept
+        : node(std::exchange(other.node, nullptr))
+        , dispose(std::move(other.dispose))
+    {
+    }
+
+    NodeHandle& operator=(NodeHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            node = std::exchange(other.node, nullptr);
+            dispose = std::move(other.dispose);
+        }
+        return *this;
+    }
+
+    ~NodeHandle()
+    {
+        reset();
+    }
+
+    // Give the node back now (retired / recycled by the policy)
+    void reset()
+    {
+        if (node)
+            dispose(node);
+        node = nullptr;
+    }
+
+    T* get() { return node ? &node->data : nullptr; }
+    T const* get() const { return node ? &node->data : nullptr; }
+
+    T& operator*() { return node->data; }
+    T const& operator*() const { return node->data; }
+
+    T* operator->() { return &node->data; }
+    T const* operator->() const { return &node->data; }
+
+    explicit operator bool() const { return node != nullptr; }
+};
@@ -0,0 +1,316 @@
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "Constants.hpp"
+#include "ThreadRegistry.hpp"
+#include "StackWaiter.hpp" // CPU_RELAX()
+
+/*
+    Fixed-size object pool: preconstructed objects recycled through an
+    index-based Treiber free-list
+
+    Key idea:
+    - All objects are constructed once, in one array, by the constructor.
+      acquire()/release() never construct, destroy or allocate.
+    - The free-list links INDICES, not pointers: next[i] is the index below i.
+      head = { index, tag } packed in ONE 64-bit word, so the tagged CAS is a
+      plain 8-byte CAS (lock-free everywhere, no cmpxchg16b).
+    - Nothing is ever freed while the pool lives, so walking next[] is always
+      safe; the tag (bumped by every head change) rejects stale walks (ABA).
+
+Per-thread caches (CacheSize > 0):
+    - Each thread keeps up to CacheSize free indices in its own slot
+      (ThreadRegistry index), touched by no other thread.
+    - acquire() with an empty cache takes CacheSize / 2 indices with ONE CAS,
+      release() with a full cache returns the coldest CacheSize / 2 with ONE CAS.
+      The shared head is touched once per CacheSize / 2 operations.
+    - Indices cached by one thread are invisible to the others: acquire()
+      can return nullptr while other caches still hold objects. Size the pool
+      with threads * CacheSize of slack. A slot (and its cache) passes to the
+      next thread when its thread exits, so nothing is lost.
+    - CacheSize == 0: every call goes to the shared free-list.
+
+Objects are handed out as they were released: reset them yourself if needed.
+Handle returns its object to the pool when it goes out of scope.
+*/
+template <typename T, size_t CacheSize = 32>
+class ObjectPool
+{
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr size_t BATCH = (CacheSize / 2 > 0) ? CacheSize / 2 : 1;
+
+    // One object per cache line: objects held by different threads never share one
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        T object;
+
+        template <typename... Args>
+        explicit Slot(Args const&... args) : object(args...) {}
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Cache
+    {
+        uint32_t count = 0;
+        uint32_t items[CacheSize > 0 ? CacheSize : 1];
+    };
+
+    const uint32_t cap;
+    Slot* slots = nullptr;
+    std::unique_ptr<std::atomic<uint32_t>[]> next;
+    std::unique_ptr<Cache[]> caches;
+
+    // { index (low 32 bits), tag (high 32 bits) }
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head{NIL};
+
+    static uint64_t pack(uint32_t index, uint32_t tag)
+    {
+        return (static_cast<uint64_t>(tag) << 32) | index;
+    }
+
+    static uint32_t word_index(uint64_t word) { return static_cast<uint32_t>(word); }
+    static uint32_t word_tag(uint64_t word) { return static_cast<uint32_t>(word >> 32); }
+
+    T* object_at(uint32_t index) const
+    {
+        return &slots[index].object;
+    }
+
+    uint32_t index_of(T* obj) const
+    {
+        auto offset = reinterpret_cast<char*>(obj) - reinterpret_cast<char*>(&slots[0].object);
+        uint32_t index = static_cast<uint32_t>(offset / static_cast<std::ptrdiff_t>(sizeof(Slot)));
+        assert(offset >= 0 && index < cap && object_at(index) == obj && "object is not from this pool");
+        return index;
+    }
+
+    // ----------------------------
+    // Free-list: push the private chain first..last (linked through next[]) with ONE CAS
+    // ----------------------------
+    void push_chain(uint32_t first, uint32_t last)
+    {
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            next[last].store(word_index(old_head), std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, pack(first, word_tag(old_head) + 1),
+                    std::memory_order_release,  // publishes the objects' last writes
+                    std::memory_order_relaxed))
+            {
+                return;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    // ----------------------------
+    // Free-list: take up to n indices into out[] with ONE CAS, returns how many
+    // ----------------------------
+    size_t pop_chain(uint32_t* out, size_t n)
+    {
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        while (true)
+        {
+            uint32_t first = word_index(old_head);
+            if (first == NIL)
+                return 0;
+
+            // A stale walk reads valid indices (nothing is freed) and fails the CAS
+            size_t count = 0;
+            uint32_t cur = first;
+            uint32_t below = NIL;
+            while (true)
+            {
+                out[count++] = cur;
+                below = next[cur].load(std::memory_order_relaxed);
+                if (count == n || below == NIL)
+                    break;
+                cur = below;
+            }
+
+            if (head.compare_exchange_weak(old_head, pack(below, word_tag(old_head) + 1),
+                    std::memory_order_acquire,
+                    std::memory_order_acquire))
+            {
+                return count;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    Cache& my_cache()
+    {
+        return caches[ThreadRegistry::thread_index()];
+    }
+
+public:
+    // ----------------------------
+    // RAII: returns the object to its pool when destroyed
+    // ----------------------------
+    class Handle
+    {
+    private:
+        ObjectPool* pool = nullptr;
+        T* obj = nullptr;
+
+    public:
+        Handle() = default;
+        Handle(ObjectPool* p, T* o) : pool(p), obj(o) {}
+
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        Handle(Handle&& other) noexcept
+            : pool(std::exchange(other.pool, nullptr))
+            , obj(std::exchange(other.obj, nullptr))
+        {
+        }
+
+        Handle& operator=(Handle&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                pool = std::exchange(other.pool, nullptr);
+                obj = std::exchange(other.obj, nullptr);
+            }
+            return *this;
+        }
+
+        ~Handle()
+        {
+            reset();
+        }
+
+        // Give the object back now
+        void reset()
+        {
+            if (obj)
+                pool->release(obj);
+            obj = nullptr;
+        }
+
+        // Keep the object: the caller must release() it to the pool later
+        T* detach()
+        {
+            return std::exchange(obj, nullptr);
+        }
+
+        T* get() const { return obj; }
+        T& operator*() const { return *obj; }
+        T* operator->() const { return obj; }
+        explicit operator bool() const { return obj != nullptr; }
+    };
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+    ObjectPool(ObjectPool&&) = delete;
+    ObjectPool& operator=(ObjectPool&&) = delete;
+
+    // Constructs 'capacity' objects as T(args...) up front
+    template <typename... Args>
+    explicit ObjectPool(size_t capacity, Args const&... args)
+        : cap(static_cast<uint32_t>(capacity))
+    {
+        if (capacity == 0 || capacity >= NIL)
+            throw std::invalid_argument("ObjectPool: capacity must be in [1, 2^32 - 1)");
+
+        slots = static_cast<Slot*>(::operator new(capacity * sizeof(Slot), std::align_val_t{alignof(Slot)}));
+        size_t built = 0;
+        try
+        {
+            for (; built < capacity; ++built)
+                new (&slots[built]) Slot(args...);
+        }
+        catch (...)
+        {
+            while (built > 0)
+                slots[--built].~Slot();
+            ::operator delete(slots, std::align_val_t{alignof(Slot)});
+            throw;
+        }
+
+        // Free-list 0 -> 1 -> ... -> capacity-1, so the first acquires walk memory forward
+        next.reset(new std::atomic<uint32_t>[capacity]);
+        for (uint32_t i = 0; i < cap; ++i)
+            next[i].store(i + 1 < cap ? i + 1 : NIL, std::memory_order_relaxed);
+        head.store(pack(0, 0), std::memory_order_release);
+
+        if constexpr (CacheSize > 0)
+            caches.reset(new Cache[ThreadRegistry::MAX_THREADS]);
+    }
+
+    //Single threaded when all other threads have joined and every object is back
+    ~ObjectPool()
+    {
+        for (uint32_t i = 0; i < cap; ++i)
+            slots[i].~Slot();
+        ::operator delete(slots, std::align_val_t{alignof(Slot)});
+    }
+
+    // A free object, or nullptr if none is left (see the cache note above)
+    T* acquire()
+    {
+        if constexpr (CacheSize > 0)
+        {
+            Cache& cache = my_cache();
+            if (cache.count == 0)
+                cache.count = static_cast<uint32_t>(pop_chain(cache.items, BATCH));
+            if (cache.count == 0)
+                return nullptr;
+            return object_at(cache.items[--cache.count]);
+        }
+        else
+        {
+            uint32_t index;
+            return pop_chain(&index, 1) ? object_at(index) : nullptr;
+        }
+    }
+
+    // obj must come from this pool's acquire()
+    void release(T* obj)
+    {
+        uint32_t index = index_of(obj);
+
+        if constexpr (CacheSize > 0)
+        {
+            Cache& cache = my_cache();
+            if (cache.count == CacheSize)
+            {
+                // Hand back the coldest BATCH (bottom of the cache) as one chain
+                for (size_t i = 0; i + 1 < BATCH; ++i)
+                    next[cache.items[i]].store(cache.items[i + 1], std::memory_order_relaxed);
+                push_chain(cache.items[0], cache.items[BATCH - 1]);
+
+                std::memmove(cache.items, cache.items + BATCH, (CacheSize - BATCH) * sizeof(uint32_t));
+                cache.count -= static_cast<uint32_t>(BATCH);
+            }
+            cache.items[cache.count++] = index;
+        }
+        else
+        {
+            push_chain(index, index);
+        }
+    }
+
+    // acquire() wrapped in a Handle (empty Handle if the pool is exhausted)
+    Handle acquire_handle()
+    {
+        return Handle(this, acquire());
+    }
+
+    size_t capacity() const
+    {
+        return cap;
+    }
+};
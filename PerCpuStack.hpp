@@ -0,0 +1,513 @@
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#define _GNU_SOURCE  // Required for CPU affinity functions
+#include <sched.h>   // Contains cpu_set_t definition, sched_getcpu()
+#include <pthread.h> // Required for pthread_setaffinity_np()
+#include <unistd.h>  // sysconf(), syscall()
+#include <sys/syscall.h>
+
+#if defined(__x86_64__) && __has_include(<sys/rseq.h>) && __has_include(<linux/membarrier.h>)
+    #include <sys/rseq.h>          // glibc >= 2.35: __rseq_offset, __rseq_size, RSEQ_SIG
+    #include <linux/membarrier.h>
+    #define PER_CPU_STACK_HAS_RSEQ 1
+#else
+    #define PER_CPU_STACK_HAS_RSEQ 0
+#endif
+
+//#include <immintrin.h> // Required for _mm_pause()
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #define CPU_RELAX() _mm_pause()
+
+#elif defined(__aarch64__) || defined(__arm64__)
+    #include <arm_acle.h>
+    #define CPU_RELAX() __yield()
+
+#else
+    #define CPU_RELAX() std::this_thread::yield()
+#endif
+
+#include "Constants.hpp"
+#include "ThreadRegistry.hpp"
+#include "EBRManager.hpp" //For Epoch Based Reclamation (EBR) in CAS fallback mode
+
+/*
+    Per-CPU LIFO using Linux restartable sequences (rseq), tcmalloc per-CPU cache style
+
+    Key idea:
+    - Per-thread sharding breaks down with more threads than cores.
+      Per-CPU sharding does not: there are never more than N_CPUS heads.
+    - A thread only touches the head of the CPU it is running on, inside an rseq
+      critical section. If the thread is preempted, migrated or signalled inside the
+      section, the kernel restarts it at the abort handler, so the final plain store
+      (the commit) either happens on the right CPU with nobody else in between, or not at all.
+    - => push/pop are a few plain loads + ONE plain store. No lock prefix, no CAS.
+
+    rseq mode (x86-64, glibc registered rseq, membarrier RSEQ available):
+        push : node->next = head[cpu]; commit head[cpu] = node     (rseq)
+        pop  : n = head[cpu]; commit head[cpu] = n->next           (rseq, load + deref inside)
+        steal: own CPU empty -> take a whole foreign chain (see steal_chain())
+
+    CAS fallback mode (no rseq): the same per-CPU heads, indexed by sched_getcpu(),
+    updated with plain Treiber CAS and reclaimed through EBR. Correct on any CPU
+    because nobody relies on "only this CPU writes this head" any more.
+
+    The mode is decided once per process and never mixed.
+
+Slot count:
+    Indexed by CPU id, so sized from the HIGHEST possible id + 1
+    (/sys/devices/system/cpu/possible, e.g. "0-3,8-11" -> 12), not from the
+    number of CPUs: ids can be sparse or above _SC_NPROCESSORS_CONF (hotplug,
+    restricted cpusets), and rseq's cpu_id is used as an index unreduced.
+    The kernel never reports an id outside the possible mask. If the file
+    cannot be read, CPU_SETSIZE (the largest id a cpu_set_t can name) is used.
+
+Why a popped node can be deleted immediately in rseq mode:
+    Only threads on the owning CPU (serialized by rseq) and a thief that holds the
+    head lock (after membarrier has aborted every in-flight section on that CPU)
+    ever dereference nodes of a head. Nobody else can hold a stale pointer to it.
+
+No pop_all():
+    In rseq mode a foreign head may only be taken the way steal_chain() does it
+    (head lock + membarrier per CPU), so draining every CPU costs one IPI
+    broadcast per non-empty CPU. That is not the one-exchange drain pop_all()
+    promises elsewhere; drain with pop() instead.
+*/
+template <typename T>
+class PerCpuStack {
+private:
+
+    EBRManager ebr; // CAS fallback mode only
+
+    // next MUST stay the first member: the rseq pop reads it at offset 0
+    struct alignas(CACHE_LINE_SIZE) Node
+    {
+        std::atomic<Node*> next;
+        T data;
+        explicit Node(T const& value) : next(nullptr), data(value) {}
+    };
+
+    struct alignas(CACHE_LINE_SIZE) CpuSlot
+    {
+        std::atomic<Node*> head{nullptr};
+    };
+
+    size_t num_cpus; // highest possible CPU id + 1, see 'Slot count'
+    std::unique_ptr<CpuSlot[]> slots;
+
+    // Highest possible CPU id + 1, from the kernel's possible mask ("0-3,8-11")
+    static size_t possible_cpus()
+    {
+        std::ifstream file("/sys/devices/system/cpu/possible");
+        std::string mask;
+        if (!(file >> mask))
+            return std::max<size_t>(CPU_SETSIZE, std::max<long>(1, sysconf(_SC_NPROCESSORS_CONF)));
+
+        // The last number in the list is the highest id
+        size_t end = mask.find_last_of("0123456789");
+        if (end == std::string::npos)
+            return CPU_SETSIZE;
+        size_t begin = mask.find_last_not_of("0123456789", end);
+        begin = (begin == std::string::npos) ? 0 : begin + 1;
+        return std::stoul(mask.substr(begin, end - begin + 1)) + 1;
+    }
+
+    // ----------------------------
+    // Thief lock: an odd "pointer" (nodes are cache-line aligned, so never odd).
+    // Unique per thief, so a thief can tell its own lock from another thief's.
+    // ----------------------------
+    static Node* lock_token()
+    {
+        return reinterpret_cast<Node*>((static_cast<uintptr_t>(ThreadRegistry::thread_index()) << 1) | 1u);
+    }
+
+    static bool is_locked(Node* p)
+    {
+        return reinterpret_cast<uintptr_t>(p) & 1u;
+    }
+
+    // ----------------------------
+    // Mode detection (once per process)
+    // ----------------------------
+    static bool detect_rseq()
+    {
+#if PER_CPU_STACK_HAS_RSEQ
+        if (__rseq_size == 0)
+            return false; // glibc did not register rseq (old kernel, or disabled by tunable)
+
+        // Needed by thieves to abort critical sections running on the victim CPU
+        if (syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_RSEQ, 0, 0) != 0)
+            return false;
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static bool rseq_mode()
+    {
+        static const bool enabled = detect_rseq();
+        return enabled;
+    }
+
+    size_t current_cpu() const
+    {
+#if PER_CPU_STACK_HAS_RSEQ
+        if (rseq_mode())
+        {
+            auto* rs = reinterpret_cast<volatile struct rseq*>(
+                static_cast<char*>(__builtin_thread_pointer()) + __rseq_offset);
+            size_t cpu = rs->cpu_id;
+            assert(cpu < num_cpus && "CPU id outside the possible mask");
+            return cpu; // not reduced: the rseq section checks this exact id
+        }
+#endif
+        int cpu = sched_getcpu();
+        return cpu < 0 ? 0 : static_cast<size_t>(cpu) % num_cpus;
+    }
+
+#if PER_CPU_STACK_HAS_RSEQ
+    // ----------------------------
+    // rseq critical sections (x86-64)
+    //
+    // Layout follows librseq:
+    //   3: struct rseq_cs { version, flags, start_ip = 1f, post_commit_offset = 2f-1f, abort_ip = 4f }
+    //   1: start          -> store &rseq_cs into rseq->rseq_cs, check cpu, work ...
+    //   2: post commit    -> the single store right before 2: is the commit
+    //   4: abort handler  -> preceded by RSEQ_SIG, as the kernel requires
+    // rseq->cpu_id is at offset 4, rseq->rseq_cs at offset 8 of the thread's rseq area.
+    // ----------------------------
+    #define PER_CPU_RSEQ_CS_TABLE                                   \
+        ".pushsection __rseq_cs, \"aw\"\n\t"                        \
+        ".balign 32\n\t"                                            \
+        "3:\n\t"                                                    \
+        ".long 0x0, 0x0\n\t"                                        \
+        ".quad 1f, (2f - 1f), 4f\n\t"                               \
+        ".popsection\n\t"                                           \
+        ".pushsection __rseq_cs_ptr_array, \"aw\"\n\t"              \
+        ".quad 3b\n\t"                                              \
+        ".popsection\n\t"                                           \
+        "leaq 3b(%%rip), %%rax\n\t"                                 \
+        "movq %%rax, %%fs:8(%[rseq_offset])\n\t"                    \
+        "1:\n\t"                                                    \
+        "cmpl %[cpu_id], %%fs:4(%[rseq_offset])\n\t"                \
+        "jnz 4f\n\t"
+
+    #define PER_CPU_RSEQ_ABORT                                      \
+        "2:\n\t"                                                    \
+        ".pushsection __rseq_failure, \"ax\"\n\t"                   \
+        ".byte 0x0f, 0xb9, 0x3d\n\t"                                \
+        ".long 0x53053053\n\t" /* RSEQ_SIG (x86) */                 \
+        "4:\n\t"                                                    \
+        "jmp %l[abort]\n\t"                                         \
+        ".popsection\n\t"
+
+    static_assert(RSEQ_SIG == 0x53053053, "rseq signature must match the abort handler");
+
+    enum RseqResult : int
+    {
+        RSEQ_COMMITTED = 0,
+        RSEQ_ABORTED,     // preempted / migrated / signal: just retry
+        RSEQ_MISMATCH,    // head changed (push) or head is empty (pop)
+        RSEQ_HEAD_LOCKED  // a thief owns this head right now
+    };
+
+    // if (*head == expect) *head = new_head;   on 'cpu' only
+    static int rseq_cmpeqv_storev(std::atomic<Node*>* head, Node* expect, Node* new_head, int cpu)
+    {
+        __asm__ __volatile__ goto (
+            PER_CPU_RSEQ_CS_TABLE
+            "cmpq %[head], %[expect]\n\t"
+            "jnz %l[mismatch]\n\t"
+            "movq %[new_head], %[head]\n\t" // commit
+            PER_CPU_RSEQ_ABORT
+            :
+            : [cpu_id] "r" (cpu),
+              [rseq_offset] "r" (__rseq_offset),
+              [head] "m" (*reinterpret_cast<Node**>(head)),
+              [expect] "r" (expect),
+              [new_head] "r" (new_head)
+            : "memory", "cc", "rax"
+            : abort, mismatch);
+        return RSEQ_COMMITTED;
+    abort:
+        return RSEQ_ABORTED;
+    mismatch:
+        return RSEQ_MISMATCH;
+    }
+
+    // n = *head; if (!n) empty; if (locked) locked; *popped = n; *head = n->next;   on 'cpu' only
+    // Loading n->next inside the section is what makes the deref safe:
+    // nobody on this CPU can pop + free n without aborting us first.
+    static int rseq_pop(std::atomic<Node*>* head, Node** popped, int cpu)
+    {
+        __asm__ __volatile__ goto (
+            PER_CPU_RSEQ_CS_TABLE
+            "movq %[head], %%rbx\n\t"
+            "testq %%rbx, %%rbx\n\t"
+            "jz %l[empty]\n\t"
+            "testq $1, %%rbx\n\t"
+            "jnz %l[locked]\n\t"
+            "movq %%rbx, %[popped]\n\t"
+            "movq (%%rbx), %%rbx\n\t"       // n->next (offset 0)
+            "movq %%rbx, %[head]\n\t"       // commit
+            PER_CPU_RSEQ_ABORT
+            :
+            : [cpu_id] "r" (cpu),
+              [rseq_offset] "r" (__rseq_offset),
+              [head] "m" (*reinterpret_cast<Node**>(head)),
+              [popped] "m" (*popped)
+            : "memory", "cc", "rax", "rbx"
+            : abort, empty, locked);
+        return RSEQ_COMMITTED;
+    abort:
+        return RSEQ_ABORTED;
+    empty:
+        return RSEQ_MISMATCH;
+    locked:
+        return RSEQ_HEAD_LOCKED;
+    }
+
+    #undef PER_CPU_RSEQ_CS_TABLE
+    #undef PER_CPU_RSEQ_ABORT
+
+    // ----------------------------
+    // rseq push of a private chain first..last onto the current CPU
+    // ----------------------------
+    void rseq_push_chain(Node* first, Node* last)
+    {
+        while (true)
+        {
+            size_t cpu = current_cpu();
+            std::atomic<Node*>* head = &slots[cpu].head;
+
+            Node* expect = head->load(std::memory_order_relaxed);
+            if (is_locked(expect))
+            {
+                CPU_RELAX(); // a thief is draining this CPU, it releases soon
+                continue;
+            }
+
+            last->next.store(expect, std::memory_order_relaxed);
+            if (rseq_cmpeqv_storev(head, expect, first, static_cast<int>(cpu)) == RSEQ_COMMITTED)
+                return;
+        }
+    }
+
+    // ----------------------------
+    // Steal a whole chain from another CPU (slow path, own CPU empty)
+    //
+    // 1. CAS victim head h -> lock token   (owner sections now see "locked" or fail their compare)
+    // 2. membarrier(RSEQ) on the victim CPU: every section in flight there is aborted or finished
+    // 3. head still == our token ? we own the chain : an owner commit overwrote us, give up
+    // ----------------------------
+    Node* steal_chain(size_t my_cpu)
+    {
+        Node* token = lock_token();
+
+        for (size_t i = 1; i < num_cpus; ++i)
+        {
+            size_t victim = (my_cpu + i) % num_cpus;
+            std::atomic<Node*>& head = slots[victim].head;
+
+            Node* chain = head.load(std::memory_order_acquire);
+            if (!chain || is_locked(chain))
+                continue;
+
+            if (!head.compare_exchange_strong(chain, token,
+                    std::memory_order_acquire,
+                    std::memory_order_relaxed))
+                continue;
+
+            if (syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ,
+                        MEMBARRIER_CMD_FLAG_CPU, static_cast<int>(victim)) != 0)
+            {
+                // Kernel without per-CPU targeting: abort sections on all CPUs
+                syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ, 0, 0);
+            }
+
+            if (head.load(std::memory_order_acquire) != token)
+                continue; // An owner committed between our CAS and the barrier
+
+            // 'chain' is ours. Hand the CPU back empty.
+            head.store(nullptr, std::memory_order_release);
+            return chain;
+        }
+        return nullptr;
+    }
+
+    bool rseq_pop_value(T& out)
+    {
+        while (true)
+        {
+            size_t cpu = current_cpu();
+            Node* node = nullptr;
+
+            switch (rseq_pop(&slots[cpu].head, &node, static_cast<int>(cpu)))
+            {
+            case RSEQ_COMMITTED:
+                out = node->data;
+                delete node; // exclusively ours, see class comment
+                return true;
+
+            case RSEQ_ABORTED:
+                continue;
+
+            case RSEQ_HEAD_LOCKED:
+                CPU_RELAX();
+                continue;
+
+            default: // Own CPU empty
+                break;
+            }
+
+            Node* chain = steal_chain(cpu);
+            if (!chain)
+                return false;
+
+            // Keep the top, move the rest to our CPU so the next pops stay local
+            Node* rest = chain->next.load(std::memory_order_relaxed);
+            if (rest)
+            {
+                Node* last = rest;
+                while (Node* next = last->next.load(std::memory_order_relaxed))
+                    last = next;
+                rseq_push_chain(rest, last);
+            }
+
+            out = chain->data;
+            delete chain;
+            return true;
+        }
+    }
+#endif // PER_CPU_STACK_HAS_RSEQ
+
+    // ----------------------------
+    // CAS fallback (Treiber + EBR on the per-CPU heads)
+    // ----------------------------
+    void cas_push(Node* new_node)
+    {
+        std::atomic<Node*>& head = slots[current_cpu()].head;
+        Node* expected_head = head.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            new_node->next.store(expected_head, std::memory_order_relaxed);
+            if (head.compare_exchange_weak(expected_head, new_node,
+                    std::memory_order_release,
+                    std::memory_order_relaxed))
+                return;
+            CPU_RELAX();
+        }
+    }
+
+    bool cas_pop_from(std::atomic<Node*>& head, T& out)
+    {
+        while (true)
+        {
+            Node* old_head = head.load(std::memory_order_acquire);
+            if (!old_head)
+                return false;
+
+            Node* new_head = old_head->next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acq_rel,
+                    std::memory_order_relaxed))
+            {
+                out = old_head->data;
+                ebr.retire_node(old_head);
+                return true;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    bool cas_pop(T& out)
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        size_t cpu = current_cpu();
+        bool ok = false;
+        for (size_t i = 0; i < num_cpus && !ok; ++i)
+            ok = cas_pop_from(slots[(cpu + i) % num_cpus].head, out);
+
+        ebr.leave_epoch();
+        return ok;
+    }
+
+public:
+    PerCpuStack(const PerCpuStack&) = delete;
+    PerCpuStack& operator=(const PerCpuStack&) = delete;
+    PerCpuStack(PerCpuStack&&) = delete;
+    PerCpuStack& operator=(PerCpuStack&&) = delete;
+
+    PerCpuStack()
+        : num_cpus(possible_cpus())
+        , slots(new CpuSlot[num_cpus])
+    {
+    }
+
+    void push(T const& value)
+    {
+        Node* new_node = new Node(value);// In HFT, use a memory pool
+
+#if PER_CPU_STACK_HAS_RSEQ
+        if (rseq_mode())
+        {
+            rseq_push_chain(new_node, new_node);
+            return;
+        }
+#endif
+        cas_push(new_node);
+    }
+
+    bool pop(T& out)
+    {
+#if PER_CPU_STACK_HAS_RSEQ
+        if (rseq_mode())
+            return rseq_pop_value(out);
+#endif
+        return cas_pop(out);
+    }
+
+    // Fast empty check (may be stale). A locked head counts as non-empty.
+    bool empty() const
+    {
+        for (size_t i = 0; i < num_cpus; ++i)
+        {
+            if (slots[i].head.load(std::memory_order_acquire))
+                return false;
+        }
+        return true;
+    }
+
+    // true: rseq critical sections, false: CAS fallback
+    static bool uses_rseq() { return rseq_mode(); }
+
+    //Single threaded when all other threads have joined and stopped using stack. So, memory_order_relaxed
+    ~PerCpuStack() {
+        for (size_t i = 0; i < num_cpus; ++i)
+        {
+            Node* current = slots[i].head.exchange(nullptr, std::memory_order_relaxed);
+            while (current) {
+                Node* next = current->next.load(std::memory_order_relaxed);
+                delete current;
+                current = next;
+            }
+        }
+    }
+};
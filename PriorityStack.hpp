@@ -0,0 +1,124 @@
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#if defined(__cpp_lib_bitops) || __cplusplus >= 202002L
+    #include <bit> // std::countl_zero
+#endif
+
+#include "Constants.hpp"
+#include "LockFreeTeiberMPMCStack_EBR.hpp"
+
+/*
+    Multi-priority LIFO: one Treiber stack per priority level + a summary bitmap
+
+    Key idea:
+    - Level L has its own head (levels[L]); bit L of 'nonempty' says
+      "level L may have elements". Higher level = more urgent.
+    - pop() reads ONE word, picks the highest set bit with one count-leading-zeros
+      and pops that level. Consumers never poll empty levels one by one.
+    - push() pushes, then sets the level's bit (a plain load first: the bit is
+      usually already set, and skipping the RMW keeps the bitmap line shared).
+    - pop() that finds the chosen level empty clears its bit.
+
+Bit never lost (Dekker):
+    push: levels[L].push() (seq_cst head CAS) ; if (!bit, seq_cst load) set bit
+    pop : clear bit ; fence (seq_cst)         ; if (!levels[L].empty()) set bit
+    A push racing the clear is seen by one side or the other, so a non-empty
+    level always ends up with its bit set. A set bit on an empty level is only
+    a stale hint: the next pop() that picks it clears it.
+    The push side has no fence of its own: it relies on Stack::push publishing
+    with a seq_cst RMW, as the EBR and HP stacks do (see StackWaiter).
+
+Within a level the order is LIFO; across levels strict priority at the
+instant of the bitmap load.
+*/
+template <typename T, size_t Levels = 8, typename Stack = LockFreeTreiberMPMCStackEBR<T>>
+class PriorityStack
+{
+private:
+    static_assert(Levels > 0 && Levels <= 64, "PriorityStack: one bit per level in a 64-bit word");
+
+    Stack levels[Levels];
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> nonempty{0};
+
+    static uint64_t bit(size_t level)
+    {
+        return uint64_t{1} << level;
+    }
+
+    // index of the highest set bit, bits != 0
+    static size_t highest(uint64_t bits)
+    {
+#if defined(__cpp_lib_bitops)
+        return 63 - static_cast<size_t>(std::countl_zero(bits));
+#else
+        return 63 - static_cast<size_t>(__builtin_clzll(bits));
+#endif
+    }
+
+public:
+    PriorityStack(const PriorityStack&) = delete;
+    PriorityStack& operator=(const PriorityStack&) = delete;
+    PriorityStack(PriorityStack&&) = delete;
+    PriorityStack& operator=(PriorityStack&&) = delete;
+
+    PriorityStack() = default;
+
+    static constexpr size_t levels_count() { return Levels; }
+
+    // level in [0, Levels), Levels - 1 is the most urgent
+    void push(T const& value, size_t level)
+    {
+        levels[level].push(value); // seq_cst head CAS
+
+        // seq_cst load after the seq_cst CAS: pairs with pop()'s clear + fence
+        if ((nonempty.load(std::memory_order_seq_cst) & bit(level)) == 0)
+            nonempty.fetch_or(bit(level), std::memory_order_release);
+    }
+
+    // Highest non-empty level first; 'level' receives where it came from
+    bool pop(T& out, size_t& level)
+    {
+        while (true)
+        {
+            uint64_t bits = nonempty.load(std::memory_order_acquire);
+            if (bits == 0)
+                return false;
+
+            size_t top = highest(bits);
+            if (levels[top].pop(out))
+            {
+                level = top;
+                return true;
+            }
+
+            // Drained (or a stale bit): clear it, then re-check for a racing push
+            nonempty.fetch_and(~bit(top), std::memory_order_acq_rel);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!levels[top].empty())
+                nonempty.fetch_or(bit(top), std::memory_order_release);
+        }
+    }
+
+    bool pop(T& out)
+    {
+        size_t level;
+        return pop(out, level);
+    }
+
+    // One load. May report non-empty for a moment after the last pop.
+    bool empty() const
+    {
+        return nonempty.load(std::memory_order_acquire) == 0;
+    }
+
+    // Snapshot of the summary bitmap, bit L = level L may have elements
+    uint64_t nonempty_levels() const
+    {
+        return nonempty.load(std::memory_order_relaxed);
+    }
+};
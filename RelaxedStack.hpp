@@ -0,0 +1,147 @@
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "Constants.hpp"
+#include "LockFreeTeiberMPMCStack_EBR.hpp"
+
+/*
+    k-relaxed stack with two-random-choice push/pop
+
+    Key idea:
+    - Free-lists do not need strict LIFO, only "recently pushed comes out soon".
+    - Spread operations over K Treiber heads (K = relaxation parameter).
+    - Power of two choices on approximate sizes:
+        push: pick two random heads, push onto the SMALLER one
+        pop : pick two random heads, pop from the LARGER one
+      This keeps the heads balanced, so the popped element is almost always
+      among the newest elements of the whole structure.
+
+Relaxation:
+    - K == 1 is a plain Treiber stack (out-of-order distance 0).
+    - Larger K -> less contention per head, larger out-of-order distance.
+      With balanced heads the expected distance grows roughly linearly in K,
+      but there is no hard bound: the size hints are approximate, so the
+      maximum exceeds K (measure_relaxation shows 6 or 7 for K == 2).
+    - Measure the actual distance with measure_relaxation<>() in the benchmark.
+
+Sizes:
+    - One relaxed counter per head, on the head's cache line pair, updated after
+      the push/pop. They are hints only and may be briefly off (even negative).
+*/
+template <typename T, size_t K = 4, typename Stack = LockFreeTreiberMPMCStackEBR<T>>
+class RelaxedStack
+{
+private:
+    static_assert(K > 0);
+
+    struct alignas(CACHE_LINE_SIZE) SubStack
+    {
+        Stack stack;
+        alignas(CACHE_LINE_SIZE) std::atomic<int64_t> approx_size{0};
+    };
+
+    SubStack subs[K];
+
+    inline static thread_local uint32_t rng = 0;
+
+    static size_t random_index()
+    {
+        if (rng == 0)
+            rng = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&rng)) | 1u;
+
+        //xorshift32, cheap and thread-local
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng % K;
+    }
+
+    int64_t size_of(size_t i) const
+    {
+        return subs[i].approx_size.load(std::memory_order_relaxed);
+    }
+
+    bool pop_from(size_t i, T& out)
+    {
+        if (!subs[i].stack.pop(out))
+            return false;
+
+        subs[i].approx_size.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+public:
+    RelaxedStack(const RelaxedStack&) = delete;
+    RelaxedStack& operator=(const RelaxedStack&) = delete;
+    RelaxedStack(RelaxedStack&&) = delete;
+    RelaxedStack& operator=(RelaxedStack&&) = delete;
+
+    RelaxedStack() = default;
+
+    void push(T const& value)
+    {
+        size_t a = random_index();
+        size_t b = random_index();
+        size_t target = (size_of(b) < size_of(a)) ? b : a;
+
+        subs[target].stack.push(value);
+        subs[target].approx_size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool pop(T& out)
+    {
+        size_t a = random_index();
+        size_t b = random_index();
+        if (size_of(b) > size_of(a))
+            std::swap(a, b);
+
+        // Larger first, then the other choice
+        if (pop_from(a, out) || (a != b && pop_from(b, out)))
+            return true;
+
+        // Both choices were empty: fall back to a full scan so that
+        // pop() only fails when every head looked empty
+        size_t start = random_index();
+        for (size_t i = 0; i < K; ++i)
+        {
+            if (pop_from((start + i) % K, out))
+                return true;
+        }
+        return false;
+    }
+
+    // Drain every head, one exchange each; one chain per head (the order
+    // across heads is relaxed anyway). The size hints drop by what was taken.
+    using Chain = typename Stack::Chain;
+
+    std::array<Chain, K> pop_all(bool fifo = false)
+    {
+        std::array<Chain, K> all;
+        for (size_t i = 0; i < K; ++i)
+        {
+            all[i] = subs[i].stack.pop_all(fifo);
+            subs[i].approx_size.fetch_sub(static_cast<int64_t>(all[i].size()), std::memory_order_relaxed);
+        }
+        return all;
+    }
+
+    // Fast empty check (may be stale)
+    bool empty() const
+    {
+        for (const SubStack& sub : subs)
+        {
+            if (!sub.stack.empty())
+                return false;
+        }
+        return true;
+    }
+
+    // Number of Treiber heads. NOT a bound on the out-of-order distance (see 'Relaxation')
+    static constexpr size_t heads() { return K; }
+};
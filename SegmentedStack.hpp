@@ -0,0 +1,302 @@
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "Constants.hpp"
+#include "EBRManager.hpp"
+#include "StackWaiter.hpp" // CPU_RELAX()
+
+/*
+    Segmented stack with fetch_add push
+
+    Key idea:
+    - A Treiber push is a CAS retry loop: under contention a producer can lose
+      any number of times. Here push RESERVES a slot with one fetch_add on the
+      current segment's counter, writes the value and publishes it with a store.
+      One RMW, no retry: wait-free.
+    - Segments (SegmentSize slots) are linked downward, newest on top:
+        current -> seg -> seg -> ... -> nullptr      (via 'prev')
+    - pop scans from the highest reserved slot down, segment by segment, and
+      claims the first READY slot with a CAS (READY -> TAKEN).
+
+Slot states:
+    EMPTY -> READY  : the pusher, after writing the value (release)
+    READY -> TAKEN  : the popper that wins the CAS (acquire), then reads the value
+    Slots are used once, so a slot never goes back to EMPTY: no ABA.
+    A reserved-but-EMPTY slot is a push still in progress; pop skips it
+    (that push has not taken effect yet).
+
+Rollover:
+    The pusher that reserves index >= SegmentSize installs a fresh segment with
+    its value already in slot 0 (one CAS on 'current'). Only this path can
+    retry, once per SegmentSize pushes, and each retry means another producer
+    installed a segment with room in it.
+
+Reclamation (EBRManager):
+    - A segment whose SegmentSize slots are all TAKEN is drained.
+    - A pop that scanned past a drained segment, or sees one right under
+      'current', runs trim(): ONE thread at a time (try-lock, others skip)
+      unlinks drained segments below 'current' and retires them. Only the
+      trimmer rewrites 'prev' of a published segment, so unlinks never race
+      each other.
+    - push and pop run inside an epoch, so a segment a slow thread still holds
+      is not freed under it. 'current' itself is never trimmed.
+
+Trivially copyable T (raw slots):
+    A Segment holds SegmentSize values up front. With a plain T member,
+    'new Segment' runs T's default constructor for every slot (a message with
+    default member initializers: SegmentSize x sizeof(T) bytes written) only
+    for push to overwrite them. For trivially copyable T the slot is raw
+    aligned bytes instead: nothing is constructed at rollover, push and pop
+    memcpy sizeof(T) bytes (same as ArrayStack's to_bits/from_bits), and
+    deleting a segment destroys nothing. T then needs no default constructor.
+
+Ordering:
+    Not strictly LIFO between pushes that overlap in time (a slow writer's slot
+    may be skipped by a pop), strictly LIFO for pushes that completed in order.
+*/
+template <typename T, size_t SegmentSize = 64>
+class SegmentedStack
+{
+private:
+    static_assert(SegmentSize > 0);
+
+    enum : uint8_t { EMPTY = 0, READY = 1, TAKEN = 2 };
+
+    static constexpr bool RAW_SLOTS = std::is_trivially_copyable_v<T>;
+
+    // Uninitialized storage for one T, see 'raw slots' above
+    struct RawValue
+    {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+    struct Slot
+    {
+        std::atomic<uint8_t> state{EMPTY};
+        std::conditional_t<RAW_SLOTS, RawValue, T> value;
+    };
+
+    static void store_value(Slot& slot, T const& value)
+    {
+        if constexpr (RAW_SLOTS)
+            std::memcpy(slot.value.bytes, &value, sizeof(T));
+        else
+            slot.value = value;
+    }
+
+    static void load_value(Slot const& slot, T& out)
+    {
+        if constexpr (RAW_SLOTS)
+            std::memcpy(&out, slot.value.bytes, sizeof(T));
+        else
+            out = slot.value;
+    }
+
+    struct Segment
+    {
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> reserved{0}; // push side: fetch_add
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> taken{0};    // pop side: drained at SegmentSize
+        std::atomic<Segment*> prev{nullptr};                       // older segment, below
+        Slot slots[SegmentSize];
+    };
+
+    // empty() walks segments too, it needs an epoch
+    mutable EBRManager ebr;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Segment*> current;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> trimming{false};
+
+    // ----------------------------
+    // Rollover: seg is full. Install a fresh segment holding 'value' in slot 0,
+    // or take a slot in the one another producer installed meanwhile.
+    // Caller is inside an epoch.
+    // ----------------------------
+    void push_slow(Segment* seg, T const& value)
+    {
+        Segment* fresh = new Segment;
+        store_value(fresh->slots[0], value);
+        fresh->slots[0].state.store(READY, std::memory_order_relaxed);
+        fresh->reserved.store(1, std::memory_order_relaxed);
+
+        while (true)
+        {
+            fresh->prev.store(seg, std::memory_order_relaxed);
+            if (current.compare_exchange_strong(seg, fresh,
+                    std::memory_order_release,  // publishes slot 0 and prev
+                    std::memory_order_acquire))
+            {
+                return;
+            }
+
+            // seg is now the newer current
+            size_t idx = seg->reserved.fetch_add(1, std::memory_order_relaxed);
+            if (idx < SegmentSize)
+            {
+                delete fresh; // never published
+                store_value(seg->slots[idx], value);
+                seg->slots[idx].state.store(READY, std::memory_order_release);
+                return;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    // ----------------------------
+    // Unlink and retire drained segments below 'current'. Single trimmer.
+    // ----------------------------
+    void trim()
+    {
+        if (trimming.load(std::memory_order_relaxed) ||
+            trimming.exchange(true, std::memory_order_acquire))
+        {
+            return; // someone else is trimming
+        }
+
+        ebr.enter_epoch();
+
+        std::vector<Segment*> unlinked;
+        Segment* above = current.load(std::memory_order_acquire);
+        Segment* seg = above->prev.load(std::memory_order_acquire);
+        while (seg)
+        {
+            Segment* below = seg->prev.load(std::memory_order_acquire);
+            if (seg->taken.load(std::memory_order_acquire) == SegmentSize)
+            {
+                // Scanners already inside seg keep following its (unchanged) prev
+                above->prev.store(below, std::memory_order_release);
+                unlinked.push_back(seg);
+            }
+            else
+            {
+                above = seg;
+            }
+            seg = below;
+        }
+
+        ebr.leave_epoch();
+        trimming.store(false, std::memory_order_release);
+
+        // Only we retire what we unlinked, so it stays valid after leave_epoch().
+        // Retiring outside our own epoch lets retire_node() actually reclaim.
+        for (Segment* seg : unlinked)
+            ebr.retire_node(seg);
+    }
+
+public:
+    SegmentedStack(const SegmentedStack&) = delete;
+    SegmentedStack& operator=(const SegmentedStack&) = delete;
+    SegmentedStack(SegmentedStack&&) = delete;
+    SegmentedStack& operator=(SegmentedStack&&) = delete;
+
+    SegmentedStack()
+        : current(new Segment)
+    {
+    }
+
+    // Wait-free except at rollover: ONE fetch_add, then plain stores
+    void push(T const& value)
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        Segment* seg = current.load(std::memory_order_acquire);
+        size_t idx = seg->reserved.fetch_add(1, std::memory_order_relaxed);
+        if (idx < SegmentSize)
+        {
+            store_value(seg->slots[idx], value);
+            seg->slots[idx].state.store(READY, std::memory_order_release);
+        }
+        else
+        {
+            push_slow(seg, value);
+        }
+
+        ebr.leave_epoch();
+    }
+
+    //Flow: enter_epoch() -> scan down -> claim READY slot -> leave_epoch() -> trim() if needed
+    bool pop(T& out)
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        bool found = false;
+        bool saw_drained = false;
+
+        Segment* top = current.load(std::memory_order_acquire);
+        for (Segment* seg = top; seg && !found; seg = seg->prev.load(std::memory_order_acquire))
+        {
+            size_t hi = std::min(seg->reserved.load(std::memory_order_acquire), SegmentSize);
+            for (size_t i = hi; i-- > 0;)
+            {
+                Slot& slot = seg->slots[i];
+                uint8_t expected = READY;
+                if (slot.state.load(std::memory_order_acquire) == READY &&
+                    slot.state.compare_exchange_strong(expected, TAKEN,
+                        std::memory_order_acquire,
+                        std::memory_order_relaxed))
+                {
+                    load_value(slot, out); // ours alone, slots are never reused
+                    seg->taken.fetch_add(1, std::memory_order_release);
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found && seg != top && seg->taken.load(std::memory_order_relaxed) == SegmentSize)
+                saw_drained = true;
+        }
+
+        // Pops served by 'top' never scan below it: also check the segment right under it
+        if (!saw_drained)
+        {
+            Segment* below = top->prev.load(std::memory_order_acquire);
+            saw_drained = below && below->taken.load(std::memory_order_relaxed) == SegmentSize;
+        }
+
+        ebr.leave_epoch(); //NEVER access a segment after leave_epoch()
+
+        if (saw_drained)
+            trim();
+        return found;
+    }
+
+    // O(elements scanned) walk, may be stale
+    bool empty() const
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        bool any = false;
+        for (Segment* seg = current.load(std::memory_order_acquire); seg && !any;
+             seg = seg->prev.load(std::memory_order_acquire))
+        {
+            size_t hi = std::min(seg->reserved.load(std::memory_order_acquire), SegmentSize);
+            for (size_t i = 0; i < hi && !any; ++i)
+                any = seg->slots[i].state.load(std::memory_order_relaxed) == READY;
+        }
+
+        ebr.leave_epoch();
+        return !any;
+    }
+
+    //Single threaded when all other threads have joined and stopped using stack. So, memory_order_relaxed
+    ~SegmentedStack()
+    {
+        Segment* seg = current.exchange(nullptr, std::memory_order_relaxed);
+        while (seg)
+        {
+            Segment* prev = seg->prev.load(std::memory_order_relaxed);
+            delete seg;
+            seg = prev;
+        }
+    }
+};
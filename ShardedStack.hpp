@@ -0,0 +1,141 @@
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "Constants.hpp"
+#include "ThreadRegistry.hpp"
+#include "LockFreeTeiberMPMCStack_EBR.hpp"
+
+/*
+    Sharded multi-stack with per-thread home shard and work stealing
+
+    Key idea:
+    - A single head is a global serialization point: every push/pop of every thread
+      bounces the same cache line.
+    - Split the stack into NUM_SHARDS independent stacks, each head on its own cache line.
+    - A thread always pushes to and pops from its home shard
+      (ThreadRegistry index % NUM_SHARDS), so threads on different shards never meet.
+    - Only when the home shard is empty does pop() steal from the other shards.
+      If Stack has steal_half(), the thief moves half of the victim onto its home
+      shard in one go, so the next pops are local again; otherwise it pops one element.
+
+Semantics (relaxed):
+    - LIFO per shard, not globally. An element pushed by another thread may be
+      popped after an older element of the home shard.
+    - pop() returns false only if every shard looked empty during the scan.
+    - pop_all() exchanges every shard's head once and returns one chain per
+      shard: LIFO (or FIFO) within a shard, shards in index order.
+
+Stack:
+    Any of the reclaiming stacks (LockFreeTreiberMPMCStackEBR / LockFreeTreiberMPMCStackHazardPointer).
+    EBR/HP domains are process-wide, so one thread can safely work on many shards.
+*/
+// Does Stack provide steal_half(Stack& victim)?
+template <typename Stack, typename = void>
+struct has_steal_half : std::false_type {};
+
+template <typename Stack>
+struct has_steal_half<Stack, std::void_t<decltype(std::declval<Stack&>().steal_half(std::declval<Stack&>()))>>
+    : std::true_type {};
+
+template <typename T, size_t NUM_SHARDS = 4, typename Stack = LockFreeTreiberMPMCStackEBR<T>>
+class ShardedStack
+{
+private:
+    static_assert(NUM_SHARDS > 0);
+
+    //Stack already aligns its head, this keeps neighbouring shards apart as a whole
+    struct alignas(CACHE_LINE_SIZE) Shard
+    {
+        Stack stack;
+    };
+
+    Shard shards[NUM_SHARDS];
+
+    // Stealing is the slow path, a shared counter here is fine
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> steal_count{0};
+
+    static size_t home_shard()
+    {
+        return static_cast<size_t>(ThreadRegistry::thread_index()) % NUM_SHARDS;
+    }
+
+public:
+    ShardedStack(const ShardedStack&) = delete;
+    ShardedStack& operator=(const ShardedStack&) = delete;
+    ShardedStack(ShardedStack&&) = delete;
+    ShardedStack& operator=(ShardedStack&&) = delete;
+
+    ShardedStack() = default;
+
+    void push(T const& value)
+    {
+        shards[home_shard()].stack.push(value);
+    }
+
+    bool pop(T& out)
+    {
+        size_t home = home_shard();
+
+        if (shards[home].stack.pop(out))
+            return true;
+
+        // Home is empty: steal, starting with the neighbour so that
+        // stealers of different homes spread over different victims
+        for (size_t i = 1; i < NUM_SHARDS; ++i)
+        {
+            Stack& victim = shards[(home + i) % NUM_SHARDS].stack;
+
+            if constexpr (has_steal_half<Stack>::value)
+            {
+                // Refill home with half of the victim, then pop locally.
+                // Home can be raced empty again by its other threads: keep scanning.
+                if (shards[home].stack.steal_half(victim) && shards[home].stack.pop(out))
+                {
+                    steal_count.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            else if (victim.pop(out))
+            {
+                steal_count.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Drain every shard, one head exchange each. Not a snapshot of the whole
+    // stack: a push to an already drained shard stays for the next call.
+    using Chain = typename Stack::Chain;
+
+    std::array<Chain, NUM_SHARDS> pop_all(bool fifo = false)
+    {
+        std::array<Chain, NUM_SHARDS> all;
+        for (size_t i = 0; i < NUM_SHARDS; ++i)
+            all[i] = shards[i].stack.pop_all(fifo);
+        return all;
+    }
+
+    // Fast empty check (may be stale)
+    bool empty() const
+    {
+        for (const Shard& shard : shards)
+        {
+            if (!shard.stack.empty())
+                return false;
+        }
+        return true;
+    }
+
+    static constexpr size_t shard_count() { return NUM_SHARDS; }
+
+    // Number of successful pops that had to steal from a foreign shard
+    uint64_t steals() const { return steal_count.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,383 @@
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <thread>
+#include <time.h> // timespec
+
+#if defined(__linux__)
+    #include <linux/futex.h> // FUTEX_WAIT_PRIVATE / FUTEX_WAKE_PRIVATE
+    #include <sys/syscall.h> // SYS_futex
+    #include <sys/eventfd.h> // eventfd()
+    #include <unistd.h>      // syscall()
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #define CPU_RELAX() _mm_pause()
+
+#elif defined(__aarch64__) || defined(__arm64__)
+    #include <arm_acle.h>
+    #define CPU_RELAX() __yield()
+
+#else
+    #define CPU_RELAX() std::this_thread::yield()
+#endif
+
+#include "Constants.hpp"
+
+/*
+    Spin-then-park support for blocking pops
+
+    Key idea:
+    - A consumer that finds the stack empty first spins for a short window
+      (SPIN_WINDOW, exponential CPU_RELAX backoff) retrying the pop.
+      The window is in time, converted to CPU_RELAX counts by a one-off
+      calibration, so it means the same on machines with very different pause
+      latencies (pause is ~10 cycles on some x86 parts and ~140 on others).
+    - Then it parks on a futex on 'seq' instead of burning the core.
+    - Producers wake only if 'waiters' is non-zero, so the uncontended push
+      pays two plain loads (waiters, event_armed), no fence and no syscall.
+
+Lost wake-up (Dekker):
+    consumer: waiters++                  ; fence ; re-check stack ; futex_wait(seq == seen)
+    producer: publish element (seq_cst RMW) ; if (waiters, seq_cst load) { seq++ ; futex_wake }
+    Either the producer sees the waiter or the consumer sees the element.
+    The producer side needs no fence: the stack's publishing CAS is seq_cst and
+    so are the loads here (on x86 a seq_cst load is a plain MOV, and a LOCK'ed
+    CAS is already a full barrier). So a stack that only pushes never pays for
+    blocking support it does not use.
+    REQUIREMENT: the caller's CAS/exchange that publishes the element must be
+    memory_order_seq_cst (Base / ABA / EBR / HP stacks: push, emplace, splice_chain;
+    BoundedStack: every push CAS, and the pop CAS that frees room for Block).
+    'seen' is read before the re-check, so a wake-up that slips in between
+    makes futex_wait return at once (seq changed).
+
+Deadlines:
+    wait_until() spins min(SPIN_WINDOW, time left), then parks with a futex
+    timeout and reports TimedOut if the deadline passes without an element.
+    Linux adds the thread's timer slack (50 us by default) to futex timeouts;
+    latency-critical threads lower it with prctl(PR_SET_TIMERSLACK, 1).
+
+Shutdown:
+    close() sets a flag next to 'seq' and wakes everybody. Consumers drain the
+    stack first, then pop_wait() returns false / try_pop_until() returns Closed.
+    The flag lives here, not in the head word: push/pop never read it, so the
+    lock-free fast paths stay exactly as they are.
+
+Readiness fd (epoll loops):
+    enable_eventfd() attaches a non-blocking eventfd that becomes readable when
+    elements arrive while it is 'armed'. The first producer to see it armed
+    disarms it with one exchange and writes, so a burst costs ONE write().
+    Consumer protocol:  fd readable -> ack_event() (read + re-arm) -> pop() until empty
+    Re-arming happens before the drain (fenced like prepare_wait()): a push that
+    the drain misses finds the fd armed and writes again.
+    close() always makes the fd readable, so the loop notices the shutdown.
+
+Platforms:
+    Linux   : futex syscall
+    others  : C++20 atomic::wait/notify if available, else yield polling
+*/
+
+// Result of a deadline-bounded pop
+enum class PopResult
+{
+    Popped,
+    TimedOut,
+    Closed,   // close() was called and the stack is drained
+};
+
+class alignas(CACHE_LINE_SIZE) StackWaiter
+{
+private:
+    using clock = std::chrono::steady_clock;
+
+    // Spin about as long as a futex park + wake round trip costs, then park
+    // (spinning longer cannot win back more than it burns)
+    static constexpr std::chrono::nanoseconds SPIN_WINDOW{std::chrono::microseconds(5)};
+    static constexpr uint32_t MAX_RELAX_PER_ROUND = 512;
+
+    std::atomic<uint32_t> seq{0};     // futex word, bumped by every wake-up
+    std::atomic<uint32_t> waiters{0}; // consumers between prepare_wait() and finish_wait()
+    std::atomic<bool> closed_flag{false};
+
+    int event_fd = -1;                // set once by enable_eventfd(), before sharing
+    std::atomic<bool> event_armed{false};
+
+    // timeout == nullptr: no timeout. Spurious returns are fine, callers re-check.
+    void futex_wait(uint32_t seen, const timespec* timeout = nullptr)
+    {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq), FUTEX_WAIT_PRIVATE, seen, timeout, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+        if (timeout)
+            std::this_thread::yield(); // atomic::wait has no timeout: poll
+        else
+            seq.wait(seen, std::memory_order_acquire);
+#else
+        (void)timeout;
+        if (seq.load(std::memory_order_acquire) == seen)
+            std::this_thread::yield();
+#endif
+    }
+
+    void futex_wake(int count)
+    {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+        if (count == 1)
+            seq.notify_one();
+        else
+            seq.notify_all();
+#else
+        (void)count;
+#endif
+    }
+
+    void signal_eventfd()
+    {
+#if defined(__linux__)
+        uint64_t one = 1;
+        ssize_t written = ::write(event_fd, &one, sizeof(one));
+        (void)written; // EAGAIN: counter saturated, fd is readable anyway
+#endif
+    }
+
+    // seq_cst loads pair with the fence in prepare_wait() / ack_event(), the
+    // caller's seq_cst publishing RMW is the other half (see 'Lost wake-up')
+    void wake(int count)
+    {
+        // Check before exchange: producers of a burst only read the armed line
+        if (event_fd >= 0 &&
+            event_armed.load(std::memory_order_seq_cst) &&
+            event_armed.exchange(false, std::memory_order_acq_rel))
+        {
+            signal_eventfd();
+        }
+
+        if (waiters.load(std::memory_order_seq_cst) == 0)
+            return; // fast path: nobody parked, no syscall
+
+        seq.fetch_add(1, std::memory_order_release);
+        futex_wake(count);
+    }
+
+    uint32_t prepare_wait()
+    {
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return seq.load(std::memory_order_acquire);
+    }
+
+    void finish_wait()
+    {
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+public:
+    StackWaiter() = default;
+    StackWaiter(const StackWaiter&) = delete;
+    StackWaiter& operator=(const StackWaiter&) = delete;
+
+    ~StackWaiter()
+    {
+#if defined(__linux__)
+        if (event_fd >= 0)
+            ::close(event_fd);
+#endif
+    }
+
+    // ----------------------------
+    // Readiness fd. Call once, before the stack is shared.
+    // Returns the fd (owned by the waiter), or -1 if unavailable.
+    // ----------------------------
+    int enable_eventfd()
+    {
+#if defined(__linux__)
+        if (event_fd < 0)
+        {
+            event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            event_armed.store(event_fd >= 0, std::memory_order_release);
+        }
+#endif
+        return event_fd;
+    }
+
+    int eventfd_handle() const { return event_fd; }
+
+    // ----------------------------
+    // Consumer: the fd was readable. Reset it and re-arm BEFORE draining the stack.
+    // ----------------------------
+    void ack_event()
+    {
+#if defined(__linux__)
+        uint64_t count;
+        ssize_t got = ::read(event_fd, &count, sizeof(count));
+        (void)got; // EAGAIN: spurious wake-up, nothing to reset
+#endif
+        event_armed.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with wake()
+    }
+
+    // ----------------------------
+    // Producer side: call AFTER the element(s) are published on head
+    // with a memory_order_seq_cst CAS
+    // ----------------------------
+    void notify_one() { wake(1); }
+    void notify_all() { wake(INT_MAX); }
+
+    // ----------------------------
+    // CPU_RELAX() per microsecond, measured once per process
+    // ----------------------------
+    static uint64_t relax_per_us()
+    {
+        static const uint64_t calibrated = []()
+        {
+            constexpr int SAMPLE = 2000;
+            auto start = clock::now();
+            for (int i = 0; i < SAMPLE; ++i)
+                CPU_RELAX();
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+            uint64_t per_us = (ns > 0) ? static_cast<uint64_t>(SAMPLE) * 1000 / static_cast<uint64_t>(ns) : SAMPLE;
+            return per_us ? per_us : 1;
+        }();
+        return calibrated;
+    }
+
+private:
+    // Retry try_pop() with exponential backoff for about 'window'.
+    // Stops early once closed: wait()/wait_until() then drain and report it.
+    template <typename TryPop>
+    bool spin(TryPop& try_pop, std::chrono::nanoseconds window)
+    {
+        uint64_t budget = static_cast<uint64_t>(window.count()) * relax_per_us() / 1000;
+        uint32_t relax = 1;
+
+        while (true)
+        {
+            if (try_pop())
+                return true;
+            if (budget < relax || closed())
+                return false;
+
+            for (uint32_t i = 0; i < relax; ++i)
+                CPU_RELAX();
+            budget -= relax;
+            if (relax < MAX_RELAX_PER_ROUND)
+                relax *= 2;
+        }
+    }
+
+public:
+    // ----------------------------
+    // Shutdown: no more elements will come. Wakes every parked consumer;
+    // they drain what is left and then see the stack as closed.
+    // Pushes are not rejected, producers must stop before close().
+    // ----------------------------
+    void close()
+    {
+        closed_flag.store(true, std::memory_order_release);
+
+        // Unconditional (close is rare): a consumer that read 'seen' before this
+        // returns from futex_wait at once, one that reads it after sees closed_flag
+        seq.fetch_add(1, std::memory_order_release);
+        futex_wake(INT_MAX);
+
+        if (event_fd >= 0)
+            signal_eventfd();
+    }
+
+    bool closed() const
+    {
+        return closed_flag.load(std::memory_order_acquire);
+    }
+
+    // ----------------------------
+    // Consumer side: retry try_pop() until it succeeds (true)
+    // or the stack is closed and drained (false).
+    // Spin for SPIN_WINDOW first, then park between attempts.
+    // ----------------------------
+    template <typename TryPop>
+    bool wait(TryPop&& try_pop)
+    {
+        if (spin(try_pop, SPIN_WINDOW))
+            return true;
+
+        while (true)
+        {
+            uint32_t seen = prepare_wait();
+
+            // closed BEFORE the re-check: everything pushed before close() is
+            // visible then, so a failed pop really means drained
+            bool is_closed = closed();
+
+            // Re-check after announcing ourselves: a push before the announcement is seen here
+            if (try_pop())
+            {
+                finish_wait();
+                return true;
+            }
+            if (is_closed)
+            {
+                finish_wait();
+                return false;
+            }
+
+            futex_wait(seen);
+            finish_wait();
+
+            if (try_pop())
+                return true;
+        }
+    }
+
+    // ----------------------------
+    // Same, but give up at 'deadline' (any clock; the futex timeout is relative)
+    // ----------------------------
+    template <typename TryPop, typename Clock, typename Duration>
+    PopResult wait_until(TryPop&& try_pop, std::chrono::time_point<Clock, Duration> const& deadline)
+    {
+        auto left = [&]() { return std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()); };
+
+        if (spin(try_pop, std::min(SPIN_WINDOW, std::max(left(), std::chrono::nanoseconds(0)))))
+            return PopResult::Popped;
+
+        while (true)
+        {
+            uint32_t seen = prepare_wait();
+            bool is_closed = closed(); // before the re-check, see wait()
+
+            if (try_pop())
+            {
+                finish_wait();
+                return PopResult::Popped;
+            }
+            if (is_closed)
+            {
+                finish_wait();
+                return PopResult::Closed;
+            }
+
+            std::chrono::nanoseconds remaining = left();
+            if (remaining.count() <= 0)
+            {
+                finish_wait();
+                return PopResult::TimedOut;
+            }
+
+            timespec timeout;
+            timeout.tv_sec  = static_cast<time_t>(remaining.count() / 1000000000);
+            timeout.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+            futex_wait(seen, &timeout);
+            finish_wait();
+
+            if (try_pop())
+                return PopResult::Popped;
+        }
+    }
+};
@@ -0,0 +1,129 @@
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+/*
+    Producer-side write-combining buffer
+
+    Key idea:
+    - Every push() on a stack is one contended CAS on head.
+    - A producer that can tolerate a small, bounded delay stages its pushes in a
+      PRIVATE chain of stack nodes (no atomics, no sharing) and splices the whole
+      chain onto head with ONE CAS, via the stack's splice_chain()
+      (the same splice push_bulk_thread_unsafe() uses).
+
+    push(v) -> new Node(v) linked on top of the private chain (plain stores)
+    flush() -> stack.splice_chain(first, last)                (one CAS)
+
+Flush triggers:
+    - size     : the chain reaches 'flush_threshold' nodes
+    - explicit : flush()
+    - deadline : the OLDEST staged element waited 'max_delay'.
+                 Checked on every push(); a producer that may go quiet must call
+                 poll() from its loop, nothing flushes behind its back.
+    - scope    : the destructor flushes what is left
+
+Order:
+    LIFO is kept within a flush (last staged is on top after the splice).
+    Other threads see the staged elements only after the flush.
+
+Rules:
+    - One StagingBuffer per producer thread (it is not thread-safe itself).
+    - Stack must befriend StagingBuffer and provide Node(T const&) + splice_chain().
+*/
+template <typename Stack>
+class StagingBuffer
+{
+private:
+    using Node  = typename Stack::Node;
+    using clock = std::chrono::steady_clock;
+
+    static constexpr size_t DEFAULT_FLUSH_THRESHOLD = 32;
+    static constexpr std::chrono::nanoseconds DEFAULT_MAX_DELAY{std::chrono::microseconds(50)};
+
+    Stack& stack;
+    size_t flush_threshold;
+    std::chrono::nanoseconds max_delay; // zero: no deadline
+
+    Node* first = nullptr; // newest, becomes head on flush
+    Node* last  = nullptr; // oldest, gets linked to the current head
+    size_t staged = 0;
+    clock::time_point oldest_staged_at{};
+
+public:
+    StagingBuffer(const StagingBuffer&) = delete;
+    StagingBuffer& operator=(const StagingBuffer&) = delete;
+    StagingBuffer(StagingBuffer&&) = delete;
+    StagingBuffer& operator=(StagingBuffer&&) = delete;
+
+    explicit StagingBuffer(Stack& target,
+                           size_t threshold = DEFAULT_FLUSH_THRESHOLD,
+                           std::chrono::nanoseconds delay = DEFAULT_MAX_DELAY)
+        : stack(target)
+        , flush_threshold(threshold ? threshold : 1)
+        , max_delay(delay)
+    {
+    }
+
+    template <typename U>
+    void push(U const& value)
+    {
+        Node* new_node = new Node(value);
+
+        if (staged == 0)
+        {
+            last = new_node;
+            if (max_delay.count())
+                oldest_staged_at = clock::now();
+        }
+        else
+        {
+            // Private chain: relaxed is enough, the splice CAS publishes everything
+            new_node->next.store(first, std::memory_order_relaxed);
+        }
+
+        first = new_node;
+        ++staged;
+
+        if (staged >= flush_threshold)
+            flush();
+        else
+            poll();
+    }
+
+    // Publish everything staged so far with a single CAS
+    void flush()
+    {
+        if (staged == 0)
+            return;
+
+        stack.splice_chain(first, last);
+
+        first = nullptr;
+        last = nullptr;
+        staged = 0;
+    }
+
+    // Flush if the oldest staged element reached its deadline. Returns true if it flushed.
+    bool poll()
+    {
+        if (staged == 0 || max_delay.count() == 0)
+            return false;
+
+        if (clock::now() - oldest_staged_at < max_delay)
+            return false;
+
+        flush();
+        return true;
+    }
+
+    size_t pending() const { return staged; }
+
+    ~StagingBuffer()
+    {
+        flush();
+    }
+};
@@ -0,0 +1,87 @@
+
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+
+/*
+    Process-wide thread slot registry
+
+    Key idea:
+    - Every thread that touches a lock-free structure gets a small dense index
+      (0..MAX_THREADS-1) that is the same for ALL structures in the process.
+    - Per-thread arrays (EBR epochs, hazard records, shard homes, ...) are indexed by it.
+    - The slot is handed back when the thread exits, so short-lived benchmark
+      threads do not exhaust MAX_THREADS over the lifetime of the process.
+
+Why process-wide:
+    If every EBRManager/HazardPointerManager handed out its own ids while the id itself
+    is thread_local, a thread touching two stacks would reuse the id it got from the
+    first one inside the second one, where another thread may already own it.
+*/
+class ThreadRegistry
+{
+public:
+    //int enough for max thread 128
+    static constexpr int MAX_THREADS = 128;
+
+    // ----------------------------
+    // Slot of the calling thread (registers on first use)
+    // ----------------------------
+    static int thread_index()
+    {
+        if (slot.index == -1)
+            slot.acquire();
+        return slot.index;
+    }
+
+    // ----------------------------
+    // Upper bound of slots ever used.
+    // Scans over per-thread arrays can stop here instead of MAX_THREADS.
+    // ----------------------------
+    static int high_watermark()
+    {
+        return watermark.load(std::memory_order_acquire);
+    }
+
+private:
+    inline static std::atomic<bool> in_use[MAX_THREADS] = {};
+    inline static std::atomic<int> watermark{0};
+
+    struct Slot
+    {
+        int index;
+
+        Slot() : index(-1) {}
+
+        void acquire()
+        {
+            for (int i = 0; i < MAX_THREADS; ++i)
+            {
+                bool expected = false;
+                if (!in_use[i].load(std::memory_order_relaxed) &&
+                    in_use[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+                {
+                    index = i;
+
+                    int seen = watermark.load(std::memory_order_relaxed);
+                    while (seen < i + 1 &&
+                           !watermark.compare_exchange_weak(seen, i + 1, std::memory_order_release))
+                    {
+                    }
+                    return;
+                }
+            }
+            throw std::runtime_error("Too many threads");
+        }
+
+        // Thread exit: hand the slot to the next thread
+        ~Slot()
+        {
+            if (index != -1)
+                in_use[index].store(false, std::memory_order_release);
+        }
+    };
+
+    inline static thread_local Slot slot;
+};
@@ -0,0 +1,251 @@
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#define _GNU_SOURCE  // Required for CPU affinity functions
+#include <sched.h>   // Contains cpu_set_t definition
+#include <pthread.h> // Required for pthread_setaffinity_np()
+
+//#include <immintrin.h> // Required for _mm_pause()
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #include <x86intrin.h> // __rdtsc()
+    #define CPU_RELAX() _mm_pause()
+
+#elif defined(__aarch64__) || defined(__arm64__)
+    #include <arm_acle.h>
+    #define CPU_RELAX() __yield()
+
+#else
+    #define CPU_RELAX() std::this_thread::yield()
+#endif
+
+#include "Constants.hpp"
+#include "ThreadRegistry.hpp"
+#include "EBRManager.hpp" //For Epoch Based Reclamation (EBR)
+
+/*
+    Timestamped stack (TS-stack, Dodds-Haas-Kirsch)
+
+    Key idea:
+    - No shared head at all. Every producer owns a single-producer pool
+      (a private LIFO list) and pushes only there.
+    - Every node carries a timestamp taken at push time.
+    - pop() scans the top of every pool and takes the YOUNGEST element
+      (largest timestamp) by flipping its 'taken' flag with one CAS.
+
+    push: owner only -> no contention with other producers
+    pop : CAS on the chosen node's flag, not on a global head
+
+Pool:
+    top -> [n5] -> [n4 taken] -> [n3] -> ...
+    - Taken nodes are skipped by readers.
+    - A taken prefix is unlinked with a CAS on the pool top (by the owner on
+      push, or by a popper on its scan) and retired through EBR, because
+      other poppers may still be scanning through them.
+
+Timestamp:
+    x86-64 : rdtsc (invariant TSC, no shared cache line at all)
+    others : shared atomic counter
+
+No pop_all():
+    Exchanging a pool top does not take its elements: a popper that scanned
+    the pool before may still flip 'taken' on any node of the chain. Draining
+    needs one flag CAS per node, which is what repeated pop() already does.
+*/
+template <typename T>
+class TimestampedStack {
+private:
+
+    mutable EBRManager ebr; // empty() also walks pools
+
+    struct alignas(CACHE_LINE_SIZE) Node
+    {
+        T data;
+        uint64_t timestamp;
+        std::atomic<bool> taken;
+        std::atomic<Node*> next;
+        Node(T const& value, uint64_t ts) : data(value), timestamp(ts), taken(false), next(nullptr) {}
+    };
+
+    // One single-producer pool per registered thread
+    struct alignas(CACHE_LINE_SIZE) Pool
+    {
+        std::atomic<Node*> top{nullptr};
+    };
+
+    Pool pools[ThreadRegistry::MAX_THREADS];
+
+#if !(defined(__x86_64__) || defined(_M_X64))
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> ts_counter{1};
+#endif
+
+    uint64_t timestamp()
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#else
+        return ts_counter.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    // ----------------------------
+    // Retire the unlinked range [first, stop)
+    // ----------------------------
+    void retire_range(Node* first, Node* stop)
+    {
+        while (first != stop)
+        {
+            Node* next = first->next.load(std::memory_order_relaxed);
+            ebr.retire_node(first);
+            first = next;
+        }
+    }
+
+    // ----------------------------
+    // Youngest untaken node of a pool, unlinking the taken prefix on the way.
+    // Caller is inside an epoch.
+    // ----------------------------
+    Node* youngest_in(Pool& pool)
+    {
+        Node* top = pool.top.load(std::memory_order_acquire);
+        Node* node = top;
+
+        while (node && node->taken.load(std::memory_order_acquire))
+            node = node->next.load(std::memory_order_relaxed);
+
+        // Help: drop the taken prefix. Only the CAS winner retires it.
+        if (node != top &&
+            pool.top.compare_exchange_strong(top, node,
+                std::memory_order_acq_rel,
+                std::memory_order_relaxed))
+        {
+            retire_range(top, node);
+        }
+        return node;
+    }
+
+public:
+    TimestampedStack(const TimestampedStack&) = delete;
+    TimestampedStack& operator=(const TimestampedStack&) = delete;
+    TimestampedStack(TimestampedStack&&) = delete;
+    TimestampedStack& operator=(TimestampedStack&&) = delete;
+
+    TimestampedStack() = default;
+
+    //NO shared head: the CAS below is on the thread's own pool and only
+    //races with a popper unlinking taken nodes, never with other producers.
+    //The epoch covers the walk over taken nodes a popper may unlink and retire.
+    void push(T const& value)
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+        Pool& pool = pools[ThreadRegistry::thread_index()];
+
+        Node* new_node = new Node(value, timestamp());// In HFT, use a memory pool
+        Node* top = pool.top.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            // Skip (and later retire) what consumers already took
+            Node* live = top;
+            while (live && live->taken.load(std::memory_order_acquire))
+                live = live->next.load(std::memory_order_relaxed);
+
+            new_node->next.store(live, std::memory_order_relaxed);
+
+            if (pool.top.compare_exchange_weak(top, new_node,
+                    std::memory_order_release, // publishes data + timestamp
+                    std::memory_order_relaxed))
+            {
+                retire_range(top, live); // unlinked now, safe to retire
+                ebr.leave_epoch();
+                return;
+            }
+            CPU_RELAX();
+        }
+    }
+
+    //Flow: enter_epoch() -> scan pools -> CAS taken flag -> leave_epoch()
+    bool pop(T& out)
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        while (true)
+        {
+            Node* best = nullptr;
+            int used = ThreadRegistry::high_watermark();
+
+            for (int i = 0; i < used; ++i)
+            {
+                Node* candidate = youngest_in(pools[i]);
+                if (candidate && (!best || candidate->timestamp > best->timestamp))
+                    best = candidate;
+            }
+
+            if (!best)
+            {
+                ebr.leave_epoch();
+                return false;
+            }
+
+            bool expected = false;
+            if (best->taken.compare_exchange_strong(expected, true,
+                    std::memory_order_acq_rel,
+                    std::memory_order_relaxed))
+            {
+                out = best->data; // we won the flag: nobody else reads data
+                ebr.leave_epoch(); //NEVER access best after leave_epoch()
+                return true;
+            }
+
+            // Another popper took it first: rescan
+            CPU_RELAX();
+        }
+    }
+
+    // Empty check (may be stale). Walks the pools, so it needs an epoch too.
+    bool empty() const
+    {
+        ebr.init_thread();
+        ebr.enter_epoch();
+
+        bool found = false;
+        int used = ThreadRegistry::high_watermark();
+        for (int i = 0; i < used && !found; ++i)
+        {
+            for (Node* node = pools[i].top.load(std::memory_order_acquire); node;
+                 node = node->next.load(std::memory_order_relaxed))
+            {
+                if (!node->taken.load(std::memory_order_acquire))
+                {
+                    found = true;
+                    break;
+                }
+            }
+        }
+
+        ebr.leave_epoch();
+        return !found;
+    }
+
+    //Single threaded when all other threads have joined and stopped using stack. So, memory_order_relaxed
+    ~TimestampedStack() {
+        for (Pool& pool : pools)
+        {
+            Node* current = pool.top.exchange(nullptr, std::memory_order_relaxed);
+            while (current) {
+                Node* next = current->next.load(std::memory_order_relaxed);
+                delete current;
+                current = next;
+            }
+        }
+    }
+};